@@ -9,6 +9,12 @@
 
 #include "bignumber.h"
 
+#include <cstdio>      // fputs, putchar
+#include <cstdlib>     // strtoul
+#include <cstring>     // memcpy, strcspn
+#include <algorithm>   // all_of, copy, copy_backward, fill, fill_n, min
+#include <ostream>     // ostream
+
 namespace redbud
 {
 namespace redbud_bignumber
@@ -22,1013 +28,2594 @@ namespace redbud_bignumber
 // ============================================================================
 // Macro definition.
 
-#define POS_PART  (0x3fffi16)  // Number part
-#define NEG_PART  (0x4000i16)  // Symbol part
-
-#define BITNUM(ch, d) (((ch) - '0') * d)
-
-#define GROUP_NUM(sz, index)           \
-  BITNUM(*((sz) + (index) - 1), 1) +   \
-  BITNUM(*((sz) + (index) - 2), 10) +  \
-  BITNUM(*((sz) + (index) - 3), 100) + \
-  BITNUM(*((sz) + (index) - 4), 1000)
-
-#define MOD(x)        ((x) % 10000)
-#define DIV(x)        ((x) / 10000)
-#define MUL(x)        ((x) * 10000)
-
-#define POSITIVE1   (0x1i16)
-#define NEGATIVE1   (0x4001i16)
-#define MAX_GROUPS  (0x3FFFFFFEui32)
-#define MAX_DIGITS  (0xFFFFFFFCi64)
-
-// ============================================================================
-// Constructor / Assignment operator
-
-BigInteger::BigInteger(const char* s)
-{
-  _string_init(s);
-}
-
-BigInteger::BigInteger(const BigInteger& other) 
-  :number_(other.number_)
-{
-}
-
-BigInteger::BigInteger(BigInteger&& other)
-  :number_(std::move(other.number_))
-{
-}
-
-BigInteger& BigInteger::operator=(const char* s)
-{
-  BigInteger tmp(s);
-  *this = std::move(tmp);
-  return *this;
-}
-
-BigInteger& BigInteger::operator=(const BigInteger& other)
-{
-  number_ = other.number_;
-  return *this;
-}
-
-BigInteger& BigInteger::operator=(BigInteger&& other)
-{
-  number_ = std::move(other.number_);
-  return *this;
-}
+#define LIMB_BITS   (32)
+#define LIMB_MAX    (0xFFFFFFFFu)
+#define DEC_BASE    (1000000000u)  // The largest power of ten in a limb.
+#define DEC_DIGITS  (9)
+#define MAX_LIMBS   (445861641u)   // 2^(32 * MAX_LIMBS) ~ 10^MAX_DIGITS
+#define MAX_DIGITS  (4294967292u)
+
+// The multiplication uses Karatsuba algorithm if the shorter operand has at
+// least KARATSUBA_THRESHOLD limbs, and Toom-3 algorithm if it has at least
+// TOOM3_THRESHOLD limbs. The thresholds are measured by benchmark.
+#define KARATSUBA_THRESHOLD (64)
+#define TOOM3_THRESHOLD     (320)
+
+// The multiplication uses number-theoretic transform if the shorter operand
+// has at least NTT_THRESHOLD limbs, and the product has at most NTT_MAX_SIZE
+// limbs, the larger ones are split by Toom-3 algorithm first.
+#define NTT_THRESHOLD       (4096)
+#define NTT_MAX_SIZE        (0x1000000u)
+
+// The division uses Burnikel-Ziegler algorithm if the divisor has at least
+// BZ_THRESHOLD limbs, and Knuth's algorithm D otherwise.
+#define BZ_THRESHOLD        (80)
+
+// The decimal conversion splits the number by the powers of 10^9 if it has
+// more than TO_STRING_THRESHOLD limbs, and divides by 10^9 repeatedly
+// otherwise.
+#define TO_STRING_THRESHOLD (40)
+
+// The parsing splits the digits by the powers 10^(19 * 2^k) if there are
+// more than FROM_STRING_THRESHOLD digits, and reads 19 digits each time
+// otherwise.
+#define FROM_STRING_THRESHOLD (1000)
+
+// The modular arithmetic uses Montgomery reduction if the modulus is odd and
+// has less than MONTGOMERY_THRESHOLD limbs, whose reduction is quadratic,
+// and Barrett reduction otherwise.
+#define MONTGOMERY_THRESHOLD (1024)
+
+// The greatest common divisor uses the half-GCD algorithm if the larger
+// operand has at least HGCD_THRESHOLD limbs, Lehmer's algorithm if it has
+// more than two limbs, and binary GCD algorithm otherwise. The recursion of
+// the half-GCD algorithm stops at HGCD_BASE limbs.
+#define HGCD_THRESHOLD (1024)
+#define HGCD_BASE      (100)
+
+// The primes of number-theoretic transform, k * 2^n + 1, and their
+// primitive roots. The product of three primes is greater than 2^87, so the
+// convolution of two sequences of 32-bit limbs of length at most 2^23 can be
+// recovered exactly by Chinese remainder theorem.
+#define NTT_P1  (2013265921u)      // 15 * 2^27 + 1
+#define NTT_G1  (31u)
+#define NTT_P2  (469762049u)       // 7 * 2^26 + 1
+#define NTT_G2  (3u)
+#define NTT_P3  (167772161u)       // 5 * 2^25 + 1
+#define NTT_G3  (3u)
 
 // ============================================================================
-// Element access.
-
-bool BigInteger::is_positive() const
-{
-  return !is_negative() && !is_zero();
-}
-
-bool BigInteger::is_negative() const
-{
-  return number_[0] > 10000;
-}
+// Limb functions.
+//
+// These functions work on the absolute values stored in limbs from low to
+// high, the carry of a limb is kept in the high half of an uint64_t.
 
-bool BigInteger::is_zero() const
+// Returns the number of limbs without the zero limbs at the high end.
+static size_t limb_normalize(const uint32_t* a, size_t n)
 {
-  return number_[0] == 0 && number_.size() == 1;
+  while (n > 0 && a[n - 1] == 0)
+  {
+    --n;
+  }
+  return n;
 }
 
-bool BigInteger::is_odd() const
+// Compares a[0, an) with b[0, bn), both of them are normalized.
+static int16_t limb_compare(const uint32_t* a, size_t an,
+                            const uint32_t* b, size_t bn)
 {
-  return (_group(0) & 1) == 1;
+  if (an != bn)
+  {
+    return an < bn ? -1 : 1;
+  }
+  while (an-- > 0)
+  {
+    if (a[an] != b[an])
+    {
+      return a[an] < b[an] ? -1 : 1;
+    }
+  }
+  return 0;
 }
 
-bool BigInteger::is_even() const
+// r[0, an) = a[0, an) + b[0, bn), an >= bn, returns the carry.
+// r may be the same as a or b.
+static uint32_t limb_add(uint32_t* r, const uint32_t* a, size_t an,
+                         const uint32_t* b, size_t bn)
 {
-  return (_group(0) & 1) == 0;
+  uint64_t c = 0;
+  size_t i = 0;
+  for (; i < bn; ++i)
+  {
+    c += static_cast<uint64_t>(a[i]) + b[i];
+    r[i] = static_cast<uint32_t>(c);
+    c >>= LIMB_BITS;
+  }
+  for (; i < an; ++i)
+  {
+    c += a[i];
+    r[i] = static_cast<uint32_t>(c);
+    c >>= LIMB_BITS;
+  }
+  return static_cast<uint32_t>(c);
 }
 
-int16_t BigInteger::compare(const self & other) const
+// r[0, an) = a[0, an) - b[0, bn), an >= bn, returns the borrow.
+// r may be the same as a or b.
+static uint32_t limb_sub(uint32_t* r, const uint32_t* a, size_t an,
+                         const uint32_t* b, size_t bn)
 {
-  if (!is_negative() ^ !other.is_negative())
-  {
-    return is_negative() ? -1 : 1;
-  }
-  else if (!is_negative())
+  uint64_t borrow = 0;
+  size_t i = 0;
+  for (; i < bn; ++i)
   {
-    return _compare(other);
+    uint64_t d = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+    r[i] = static_cast<uint32_t>(d);
+    borrow = d >> 63;
   }
-  else
+  for (; i < an; ++i)
   {
-    return other._compare(*this);
+    uint64_t d = static_cast<uint64_t>(a[i]) - borrow;
+    r[i] = static_cast<uint32_t>(d);
+    borrow = d >> 63;
   }
+  return static_cast<uint32_t>(borrow);
 }
 
-size_t BigInteger::digits() const
+// r[0, n) = a[0, n) * m + c, returns the carry. r may be the same as a.
+static uint32_t limb_mul_add_1(uint32_t* r, const uint32_t* a, size_t n,
+                               uint32_t m, uint32_t c)
 {
-  size_t d = ((_group_size() - 1) << 2) + 1;
-  for (int16_t i = 10; number_.back() / i; ++d, i *= 10)
-    ; // Empty loop body.
-  return d;
+  uint64_t carry = c;
+  for (size_t i = 0; i < n; ++i)
+  {
+    carry += static_cast<uint64_t>(a[i]) * m;
+    r[i] = static_cast<uint32_t>(carry);
+    carry >>= LIMB_BITS;
+  }
+  return static_cast<uint32_t>(carry);
 }
 
-size_t BigInteger::max_digits() const
+// r[0, n) = a[0, n) * m + c by a 64-bit multiplier, returns the carry,
+// which is less than 2^64. r may be the same as a.
+static uint64_t limb_mul_add_2(uint32_t* r, const uint32_t* a, size_t n,
+                               uint64_t m, uint64_t c)
 {
-  return static_cast<size_t>(-4);
+  const uint64_t mask = LIMB_MAX;
+  const uint64_t lo = m & mask;
+  const uint64_t hi = m >> LIMB_BITS;
+  uint64_t carry = c;
+  for (size_t i = 0; i < n; ++i)
+  {
+    uint64_t p0 = a[i] * lo;
+    uint64_t p1 = a[i] * hi;
+    uint64_t s = (p0 & mask) + (carry & mask);
+    r[i] = static_cast<uint32_t>(s);
+    carry = (p0 >> LIMB_BITS) + (carry >> LIMB_BITS) + p1 + (s >> LIMB_BITS);
+  }
+  return carry;
 }
 
-BigInteger BigInteger::opposite() const
+// r[0, n) += a[0, n) * m, returns the carry.
+static uint32_t limb_addmul_1(uint32_t* r, const uint32_t* a, size_t n,
+                              uint32_t m)
 {
-  BigInteger result(*this);
-  result.reverse();
-  return result;
+  uint64_t carry = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    carry += static_cast<uint64_t>(a[i]) * m + r[i];
+    r[i] = static_cast<uint32_t>(carry);
+    carry >>= LIMB_BITS;
+  }
+  return static_cast<uint32_t>(carry);
 }
 
-BigInteger BigInteger::absolute() const
+// r[0, an + bn) = a[0, an) * b[0, bn) by schoolbook multiplication,
+// r can not overlap a or b.
+static void limb_mul_basecase(uint32_t* r, const uint32_t* a, size_t an,
+                              const uint32_t* b, size_t bn)
 {
-  BigInteger result(*this);
-  result._symbol_pos();
-  return result;
+  std::fill(r, r + an + bn, 0u);
+  for (size_t j = 0; j < bn; ++j)
+  {
+    r[j + an] = limb_addmul_1(r + j, a, an, b[j]);
+  }
 }
 
-BigInteger BigInteger::power(const BigInteger& n) const
+// q[0, n) = a[0, n) / d, returns the remainder. q may be the same as a.
+static uint32_t limb_div_1(uint32_t* q, const uint32_t* a, size_t n,
+                           uint32_t d)
 {
-  return _power_of(n);
+  uint64_t r = 0;
+  while (n-- > 0)
+  {
+    r = (r << LIMB_BITS) | a[n];
+    q[n] = static_cast<uint32_t>(r / d);
+    r %= d;
+  }
+  return static_cast<uint32_t>(r);
 }
 
-std::string BigInteger::to_string() const
+// r[0, n) -= a[0, n) * m, returns the borrow.
+static uint32_t limb_submul_1(uint32_t* r, const uint32_t* a, size_t n,
+                              uint32_t m)
 {
-  std::string s = is_negative() ? "-" : "";
-  for (int32_t i = _group_size() - 1; i >= 0; --i)
+  uint64_t carry = 0;
+  for (size_t i = 0; i < n; ++i)
   {
-    s += _group_to_string(i);
+    carry += static_cast<uint64_t>(a[i]) * m;
+    uint32_t low = static_cast<uint32_t>(carry);
+    carry >>= LIMB_BITS;
+    if (r[i] < low)
+    {
+      ++carry;
+    }
+    r[i] -= low;
   }
-  return s;
+  return static_cast<uint32_t>(carry);
 }
 
-void BigInteger::print(char sep) const
+// r[0, n) = a[0, n) << s, 0 <= s < 32, returns the bits shifted out.
+// r may be the same as or higher than a.
+static uint32_t limb_lshift(uint32_t* r, const uint32_t* a, size_t n,
+                            unsigned s)
 {
-  if (is_negative())
+  if (s == 0)
   {
-    std::printf("-%d", _group(_group_size() - 1));
+    std::copy_backward(a, a + n, r + n);
+    return 0;
   }
-  else
+  uint32_t out = a[n - 1] >> (LIMB_BITS - s);
+  for (size_t i = n - 1; i > 0; --i)
   {
-    std::printf("%d", _group(_group_size() - 1));
+    r[i] = (a[i] << s) | (a[i - 1] >> (LIMB_BITS - s));
   }
-  for (int32_t i = _group_size() - 2; i >= 0; --i)
+  r[0] = a[0] << s;
+  return out;
+}
+
+// r[0, n) = a[0, n) >> s, 0 <= s < 32. r may be the same as or lower than a.
+static void limb_rshift(uint32_t* r, const uint32_t* a, size_t n, unsigned s)
+{
+  if (s == 0)
   {
-    std::printf("%04d", _group(i));
+    std::copy(a, a + n, r);
+    return;
   }
-  if (sep != '\0')
+  for (size_t i = 0; i + 1 < n; ++i)
   {
-    std::printf("%c", sep);
+    r[i] = (a[i] >> s) | (a[i + 1] << (LIMB_BITS - s));
   }
+  r[n - 1] = a[n - 1] >> s;
 }
 
-// ============================================================================
-// Modifiers.
-
-void BigInteger::reverse()
+// r[0, 2n) = a[0, n)^2, r can not overlap a. The products a[i] * a[j]
+// (i < j) are computed once and doubled, then adds the squares a[i]^2.
+static void limb_sqr_basecase(uint32_t* r, const uint32_t* a, size_t n)
 {
-  if (is_negative())
+  std::fill(r, r + n * 2, 0u);
+  for (size_t i = 0; i + 1 < n; ++i)
   {
-    _symbol_pos();
+    r[i + n] = limb_addmul_1(r + i * 2 + 1, a + i + 1, n - i - 1, a[i]);
   }
-  else if (is_positive())
+  limb_lshift(r, r, n * 2, 1);
+  uint64_t carry = 0;
+  for (size_t i = 0; i < n; ++i)
   {
-    _symbol_neg();
+    uint64_t p = static_cast<uint64_t>(a[i]) * a[i];
+    carry += static_cast<uint64_t>(r[i * 2]) + (p & LIMB_MAX);
+    r[i * 2] = static_cast<uint32_t>(carry);
+    carry >>= LIMB_BITS;
+    carry += static_cast<uint64_t>(r[i * 2 + 1]) + (p >> LIMB_BITS);
+    r[i * 2 + 1] = static_cast<uint32_t>(carry);
+    carry >>= LIMB_BITS;
   }
 }
 
-void BigInteger::swap(BigInteger& rhs)
+// Returns the number of significant bits of x.
+static size_t limb_bits(uint32_t x)
 {
-  number_.swap(rhs.number_);
+  size_t n = 0;
+  for (; x != 0; x >>= 1)
+  {
+    ++n;
+  }
+  return n;
 }
 
-// ============================================================================
-// Overloads operators.
+// Returns the 64 bits of a[0, n) from the hth bit.
+static uint64_t limb_extract(const uint32_t* a, size_t n, size_t h)
+{
+  size_t k = h / LIMB_BITS;
+  unsigned s = static_cast<unsigned>(h % LIMB_BITS);
+  uint64_t lo = k < n ? a[k] : 0;
+  uint64_t mid = k + 1 < n ? a[k + 1] : 0;
+  uint64_t hi = k + 2 < n ? a[k + 2] : 0;
+  uint64_t r = ((mid << LIMB_BITS) | lo) >> s;
+  return s == 0 ? r : r | (hi << (2 * LIMB_BITS - s));
+}
 
-BigInteger& BigInteger::operator+=(const BigInteger& addend)
+// Returns the greatest common divisor of x and y by binary GCD algorithm.
+static uint64_t word_gcd(uint64_t x, uint64_t y)
 {
-  if (!is_negative() && !addend.is_negative())
-  {
-    _plus_with_pos(addend);
-  }
-  else if (!is_negative() && addend.is_negative())
+  if (x == 0 || y == 0)
   {
-    // x + (-y) = x - y
-    _minus_with_pos(addend.opposite());
+    return x | y;
   }
-  else if (is_negative() && !addend.is_negative())
+  unsigned shift = 0;
+  for (; ((x | y) & 1) == 0; x >>= 1, y >>= 1)
   {
-    // (-x) + y = -(x - y)
-    _symbol_pos();
-    _minus_with_pos(addend);
-    reverse();
+    ++shift;
   }
-  else
+  for (; (x & 1) == 0; x >>= 1)
+    ; // Empty loop body.
+  while (y != 0)
   {
-    // (-x) + (-y) = -(x + y)
-    _symbol_pos();
-    _plus_with_pos(addend.opposite());
-    _symbol_neg();
+    for (; (y & 1) == 0; y >>= 1)
+      ; // Empty loop body.
+    if (x > y)
+    {
+      std::swap(x, y);
+    }
+    y -= x;
   }
-  return *this;
+  return x << shift;
 }
 
-BigInteger& BigInteger::operator-=(const BigInteger& subtrahend)
+// Returns the number of one bits of x.
+static size_t limb_popcount(uint32_t x)
+{
+  x = x - ((x >> 1) & 0x55555555u);
+  x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+  x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+  return static_cast<size_t>((x * 0x01010101u) >> 24);
+}
+
+// Returns the ith limb of a[0, an) in two's complement, which is the limb of
+// ~(a - 1) if negative. The borrow of (a - 1) from the lower limbs is kept
+// in borrow, which starts with one.
+static uint32_t limb_twos(const uint32_t* a, size_t an, size_t i,
+                          bool negative, uint32_t& borrow)
 {
-  if (!is_negative() && !subtrahend.is_negative())
+  uint32_t v = i < an ? a[i] : 0;
+  if (!negative)
   {
-    _minus_with_pos(subtrahend);
+    return v;
   }
-  else if (!is_negative() && subtrahend.is_negative())
+  uint32_t d = v - borrow;
+  borrow = v < borrow ? 1 : 0;
+  return ~d;
+}
+
+// r[0, n) = a op b in two's complement, where a[0, an) and b[0, bn) are the
+// absolute values, n > max(an, bn). r may be the same as a or b. Returns true
+// if the result is negative, and r is its absolute value.
+template <typename Op>
+static bool limb_bitwise(uint32_t* r, const uint32_t* a, size_t an, bool na,
+                         const uint32_t* b, size_t bn, bool nb, size_t n,
+                         Op op)
+{
+  uint32_t ba = 1;
+  uint32_t bb = 1;
+  for (size_t i = 0; i < n; ++i)
   {
-    // x - (-y) = x + y
-    _plus_with_pos(subtrahend.opposite());
+    r[i] = op(limb_twos(a, an, i, na, ba), limb_twos(b, bn, i, nb, bb));
   }
-  else if (is_negative() && !subtrahend.is_negative())
+  if ((r[n - 1] >> (LIMB_BITS - 1)) == 0)
   {
-    // (-x) - y = -(x + y)
-    _symbol_pos();
-    _plus_with_pos(subtrahend);
-    _symbol_neg();
+    return false;
   }
-  else
-  {
-    // (-x) - (-y) = -(x - y)
-    _symbol_pos();
-    _minus_with_pos(subtrahend.opposite());
-    reverse();
+  // The absolute value is ~r + 1.
+  uint32_t carry = 1;
+  for (size_t i = 0; i < n; ++i)
+  {
+    r[i] = ~r[i] + carry;
+    carry = carry != 0 && r[i] == 0 ? 1 : 0;
+  }
+  return true;
+}
+
+// q[0, an - dn + 1) = a[0, an) / d[0, dn), r[0, dn) = a[0, an) % d[0, dn)
+// by Knuth's algorithm D, an >= dn >= 2 and d[dn - 1] != 0.
+static void limb_divmod(uint32_t* q, uint32_t* r, const uint32_t* a,
+                        size_t an, const uint32_t* d, size_t dn)
+{
+  // Normalizes the divisor so that its highest bit is set, then each
+  // estimated quotient limb is at most one greater than the real one after
+  // the correction by the second limb of the divisor.
+  unsigned s = static_cast<unsigned>(LIMB_BITS - limb_bits(d[dn - 1]));
+  std::vector<uint32_t> buf(an + 1 + dn);
+  uint32_t* u = buf.data();
+  uint32_t* v = u + an + 1;
+  u[an] = limb_lshift(u, a, an, s);
+  limb_lshift(v, d, dn, s);
+  const uint64_t vh = v[dn - 1];
+  const uint64_t vl = v[dn - 2];
+  for (size_t j = an - dn + 1; j-- > 0; )
+  {
+    uint64_t num = (static_cast<uint64_t>(u[j + dn]) << LIMB_BITS)
+      | u[j + dn - 1];
+    uint64_t qhat = num / vh;
+    uint64_t rhat = num % vh;
+    while (qhat > LIMB_MAX ||
+           qhat * vl > ((rhat << LIMB_BITS) | u[j + dn - 2]))
+    {
+      --qhat;
+      rhat += vh;
+      if (rhat > LIMB_MAX)
+      {
+        break;
+      }
+    }
+    uint32_t borrow = limb_submul_1(u + j, v, dn,
+                                    static_cast<uint32_t>(qhat));
+    bool negative = u[j + dn] < borrow;
+    u[j + dn] -= borrow;
+    if (negative)
+    {
+      // Adds back, the quotient limb was one too large.
+      --qhat;
+      u[j + dn] += limb_add(u + j, u + j, dn, v, dn);
+    }
+    q[j] = static_cast<uint32_t>(qhat);
   }
-  _clear_excess_zeros();
-  return *this;
+  limb_rshift(r, u, dn, s);
 }
 
-BigInteger& BigInteger::operator*=(const BigInteger& multiplier)
+// ============================================================================
+// Number-theoretic transform.
+
+// Returns a^e mod P.
+template <uint32_t P>
+static uint32_t mod_pow(uint32_t a, uint64_t e)
 {
-  if (is_zero() || multiplier.is_zero())
+  uint64_t result = 1;
+  uint64_t base = a % P;
+  for (; e != 0; e >>= 1)
   {
-    *this = BigInteger(0);
-    return *this;
-  }
-  bool result_neg = is_negative() ^ multiplier.is_negative();
-  _symbol_pos();
-  int64_t pow_of_ten = multiplier.absolute()._is_pow10();
-  if (pow_of_ten >= 0)
-  {
-    _shift10(static_cast<size_t>(pow_of_ten), kMoveLeft);
+    if (e & 1)
+    {
+      result = result * base % P;
+    }
+    base = base * base % P;
   }
-  else
+  return static_cast<uint32_t>(result);
+}
+
+// Transforms a[0, n) in place, n is a power of two. The inverse transform
+// does not divide by n.
+template <uint32_t P, uint32_t G>
+static void ntt_transform(uint32_t* a, size_t n, bool inverse)
+{
+  for (size_t i = 1, j = 0; i < n; ++i)
   {
-    _multiply_with_pos(multiplier.absolute());
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j)
+    {
+      std::swap(a[i], a[j]);
+    }
   }
-  if (result_neg)
+  std::vector<uint32_t> roots(n / 2);
+  for (size_t len = 2; len <= n; len <<= 1)
   {
-    _symbol_neg();
+    uint32_t w = mod_pow<P>(G, (P - 1) / len);
+    if (inverse)
+    {
+      w = mod_pow<P>(w, P - 2);
+    }
+    size_t half = len / 2;
+    roots[0] = 1;
+    for (size_t j = 1; j < half; ++j)
+    {
+      roots[j] = static_cast<uint32_t>(
+        static_cast<uint64_t>(roots[j - 1]) * w % P);
+    }
+    for (size_t i = 0; i < n; i += len)
+    {
+      for (size_t j = 0; j < half; ++j)
+      {
+        uint32_t u = a[i + j];
+        uint32_t v = static_cast<uint32_t>(
+          static_cast<uint64_t>(a[i + j + half]) * roots[j] % P);
+        a[i + j] = u + v >= P ? u + v - P : u + v;
+        a[i + j + half] = u >= v ? u - v : u + P - v;
+      }
+    }
   }
-  return *this;
 }
 
-BigInteger& BigInteger::operator/=(const BigInteger& divisor)
+// c[0, n) = the cyclic convolution of a[0, an) and b[0, bn) modulo P.
+template <uint32_t P, uint32_t G>
+static void ntt_convolve(uint32_t* c, const uint32_t* a, size_t an,
+                         const uint32_t* b, size_t bn, size_t n)
 {
-  REDBUD_THROW_EX_IF(divisor.is_zero(), "The divisor can not be zero.");
-  bool result_neg = is_negative() ^ divisor.is_negative();
-  _symbol_pos();
-  int16_t comp = compare(divisor.absolute());
-  if (is_zero() || comp < 0)
+  for (size_t i = 0; i < n; ++i)
   {
-    *this = BigInteger(0);
+    c[i] = i < an ? a[i] % P : 0;
   }
-  else if (comp == 0)
+  ntt_transform<P, G>(c, n, false);
+  if (a == b && an == bn)
   {
-    *this = BigInteger(1);
+    // Squaring transforms once.
+    for (size_t i = 0; i < n; ++i)
+    {
+      c[i] = static_cast<uint32_t>(static_cast<uint64_t>(c[i]) * c[i] % P);
+    }
   }
   else
   {
-    int64_t pow_of_ten = divisor.absolute()._is_pow10();
-    if (pow_of_ten >= 0)
+    std::vector<uint32_t> t(n);
+    for (size_t i = 0; i < n; ++i)
     {
-      _shift10(static_cast<size_t>(pow_of_ten), kMoveRight);
+      t[i] = i < bn ? b[i] % P : 0;
     }
-    else
+    ntt_transform<P, G>(t.data(), n, false);
+    for (size_t i = 0; i < n; ++i)
     {
-      _divide_with_pos(divisor.absolute());
+      c[i] = static_cast<uint32_t>(static_cast<uint64_t>(c[i]) * t[i] % P);
     }
   }
-  if (result_neg)
+  ntt_transform<P, G>(c, n, true);
+  uint64_t inv = mod_pow<P>(static_cast<uint32_t>(n % P), P - 2);
+  for (size_t i = 0; i < n; ++i)
   {
-    _symbol_neg();
+    c[i] = static_cast<uint32_t>(c[i] * inv % P);
   }
-  return *this;
-}
-
-BigInteger& BigInteger::operator%=(const BigInteger& modulus)
-{
-  REDBUD_THROW_EX_IF(modulus.is_zero(), "The modulus can not be zero.");
-  // Modulus operation(%) only guaranteed (a / b) * b + (a % b) == a.
-  self tmp = (*this / modulus) * modulus;
-  *this -= tmp;
-  return *this;
 }
 
-BigInteger& BigInteger::operator<<=(const BigInteger& n)
+// r[0, an + bn) = a[0, an) * b[0, bn), (an + bn) <= NTT_MAX_SIZE.
+// Convolves the limbs modulo three primes, then recovers each coefficient
+// by Garner's algorithm and adds it to the result with carry.
+static void limb_mul_ntt(uint32_t* r, const uint32_t* a, size_t an,
+                         const uint32_t* b, size_t bn)
 {
-  REDBUD_THROW_EX_IF(n.is_negative(), "Positive required.");
-  *this *= BigInteger(2).power(n);
-  return *this;
-}
+  size_t n = 1;
+  while (n < an + bn - 1)
+  {
+    n <<= 1;
+  }
+  std::vector<uint32_t> c(n * 3);
+  uint32_t* c1 = c.data();
+  uint32_t* c2 = c1 + n;
+  uint32_t* c3 = c2 + n;
+  ntt_convolve<NTT_P1, NTT_G1>(c1, a, an, b, bn, n);
+  ntt_convolve<NTT_P2, NTT_G2>(c2, a, an, b, bn, n);
+  ntt_convolve<NTT_P3, NTT_G3>(c3, a, an, b, bn, n);
 
-BigInteger& BigInteger::operator>>=(const BigInteger& n)
-{
-  REDBUD_THROW_EX_IF(n.is_negative(), "Positive required.");
-  *this /= BigInteger(2).power(n);
-  return *this;
-}
+  const uint64_t inv12 = mod_pow<NTT_P2>(NTT_P1, NTT_P2 - 2);
+  const uint64_t inv13 = mod_pow<NTT_P3>(NTT_P1, NTT_P3 - 2);
+  const uint64_t inv23 = mod_pow<NTT_P3>(NTT_P2, NTT_P3 - 2);
+  const uint64_t p12 = static_cast<uint64_t>(NTT_P1) * NTT_P2;
+  const uint64_t mask = LIMB_MAX;
 
-BigInteger& BigInteger::operator++()
-{
-  if (!is_negative())
+  // The carry is kept in three 64-bit words for the position i, (i + 1)
+  // and (i + 2), each word holds a little more than 32 bits.
+  uint64_t w0 = 0;
+  uint64_t w1 = 0;
+  uint64_t w2 = 0;
+  for (size_t i = 0; i < an + bn; ++i)
   {
-    size_t g = 0;
-    bool carry = false;
-    do
+    if (i < an + bn - 1)
     {
-      carry = _add_and_carry(g, 1);
-      ++g;
-    } while (carry);
-  }
-  else
-  {
-    // -x + 1 = -(x - 1)
-    reverse();
-    operator--();
-    reverse();
+      // x = v1 + v2 * p1 + v3 * p1 * p2
+      uint64_t v1 = c1[i];
+      uint64_t v2 = (c2[i] + NTT_P2 - v1 % NTT_P2) * inv12 % NTT_P2;
+      uint64_t v3 = (c3[i] + NTT_P3 - v1 % NTT_P3) * inv13 % NTT_P3;
+      v3 = (v3 + NTT_P3 - v2 % NTT_P3) * inv23 % NTT_P3;
+      uint64_t t = v2 * NTT_P1 + v1;
+      uint64_t lo = v3 * (p12 & mask);
+      uint64_t hi = v3 * (p12 >> LIMB_BITS);
+      uint64_t s0 = (t & mask) + (lo & mask);
+      uint64_t s1 = (t >> LIMB_BITS) + (lo >> LIMB_BITS) + (hi & mask)
+        + (s0 >> LIMB_BITS);
+      w0 += s0 & mask;
+      w1 += s1 & mask;
+      w2 += (hi >> LIMB_BITS) + (s1 >> LIMB_BITS);
+    }
+    r[i] = static_cast<uint32_t>(w0);
+    w0 = w1 + (w0 >> LIMB_BITS);
+    w1 = w2;
+    w2 = 0;
   }
-  return *this;
 }
 
-BigInteger& BigInteger::operator--()
+// ============================================================================
+// Decimal conversion.
+
+// The two digits of 00, 01, ..., 99.
+static const char kDigitPairs[] =
+  "00010203040506070809101112131415161718192021222324"
+  "25262728293031323334353637383940414243444546474849"
+  "50515253545556575859606162636465666768697071727374"
+  "75767778798081828384858687888990919293949596979899";
+
+// q[0, n) = a[0, n) / 10^9, returns the remainder. The divisor is a
+// constant, so the compiler replaces the division by a multiplication.
+static uint32_t limb_div_dec(uint32_t* q, const uint32_t* a, size_t n)
 {
-  if (is_zero())
-  {
-    number_[0] = NEGATIVE1;
-  }
-  else if (!is_negative())
-  {
-    size_t g = 0;
-    bool borrow = false;
-    do
-    {
-      if (_group(g) == 0)
-      {
-        _group_adjust(g, 9999);
-        ++g, borrow = 1;
-      }
-      else
-      {
-        borrow = _add_and_carry(g, -1);
-      }
-    } while (borrow);
-    _clear_excess_zeros();
-  }
-  else
+  uint64_t r = 0;
+  while (n-- > 0)
   {
-    // -x - 1 = -(x + 1)
-    reverse();
-    operator++();
-    reverse();
+    r = (r << LIMB_BITS) | a[n];
+    q[n] = static_cast<uint32_t>(r / DEC_BASE);
+    r %= DEC_BASE;
   }
-  return *this;
+  return static_cast<uint32_t>(r);
 }
 
-BigInteger BigInteger::operator++(int)
+// 10^0, 10^1, ..., 10^19.
+static const uint64_t kPow10[] =
 {
-  BigInteger tmp(*this);
-  ++*this;
-  return tmp;
-}
+  1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+  10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+  100000000000ull, 1000000000000ull, 10000000000000ull,
+  100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+  100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
 
-BigInteger BigInteger::operator--(int)
+// Writes the nine digits of n (n < 10^9) with the leading zeros.
+static void write_dec9(char* p, uint32_t n)
 {
-  BigInteger tmp(*this);
-  --*this;
-  return tmp;
+  p[0] = static_cast<char>('0' + n / 100000000);
+  n %= 100000000;
+  for (size_t i = 4; i-- > 0; n /= 100)
+  {
+    std::memcpy(p + 1 + i * 2, kDigitPairs + n % 100 * 2, 2);
+  }
 }
 
-BigInteger BigInteger::operator+()
-{
-  return *this;
-}
+// ============================================================================
+// LimbVector
 
-BigInteger BigInteger::operator-()
+void LimbVector::reserve(size_t n)
 {
-  return opposite();
+  if (n <= capacity_)
+  {
+    return;
+  }
+  size_t capacity = std::max<size_t>(n, static_cast<size_t>(capacity_) * 2);
+  uint32_t* p = new uint32_t[capacity];
+  uint32_t size = size_;
+  std::copy(begin(), end(), p);
+  _free();
+  heap_ = p;
+  size_ = size;
+  capacity_ = static_cast<uint32_t>(capacity);
 }
 
-// ============================================================================
-// Helper functions.
-
-// Set the sign of this BigInteger.
-void BigInteger::_symbol_pos()
+void LimbVector::resize(size_t n)
 {
-  number_[0] &= POS_PART;
+  if (n > size_)
+  {
+    reserve(n);
+    std::fill(end(), data() + n, 0u);
+  }
+  size_ = static_cast<uint32_t>(n);
 }
 
-void BigInteger::_symbol_neg()
+void LimbVector::push_back(uint32_t value)
 {
-  if (!is_zero())
+  if (size_ == capacity_)
   {
-    number_[0] |= NEG_PART;
+    reserve(size_ + 1);
   }
+  data()[size_++] = value;
 }
 
-// Returns the number of nth group, does not include the sign.
-int16_t BigInteger::_group(size_t n) const
+void LimbVector::assign(size_t n, uint32_t value)
 {
-  return number_[n] & POS_PART;
+  reserve(n);
+  std::fill(data(), data() + n, value);
+  size_ = static_cast<uint32_t>(n);
 }
 
-size_t BigInteger::_group_size() const
+void LimbVector::assign(const uint32_t* first, const uint32_t* last)
 {
-  return number_.size();
+  size_t n = static_cast<size_t>(last - first);
+  reserve(n);
+  std::copy(first, last, data());
+  size_ = static_cast<uint32_t>(n);
 }
 
-void BigInteger::_group_push(int16_t value)
+void LimbVector::swap(LimbVector& other) noexcept
 {
-  REDBUD_THROW_EX_IF(_group_size() >= MAX_GROUPS, "Overflow.");
-  number_.push_back(value);
+  LimbVector tmp(std::move(other));
+  other = std::move(*this);
+  *this = std::move(tmp);
 }
 
-void BigInteger::_group_adjust(size_t n, int16_t value)
+bool operator==(const LimbVector& lhs, const LimbVector& rhs)
 {
-  number_[n] = value;
+  return lhs.size() == rhs.size() &&
+    std::equal(lhs.begin(), lhs.end(), rhs.begin());
 }
 
-// Clear the extra zero in front of this BigInteger.
-void BigInteger::_clear_excess_zeros()
+void LimbVector::_free() noexcept
 {
-  for (size_t i = _group_size() - 1; i > 0 && _group(i) == 0; --i)
+  if (!_inline())
   {
-    number_.pop_back();
+    delete[] heap_;
+    capacity_ = kInlineLimbs;
   }
+  size_ = 0;
 }
 
-// The BigInteger calls this function must be non-negative.
-// If this BigInteger is power of ten, then returns to the power.
-// Otherwise it returns -1.
-int64_t BigInteger::_is_pow10() const
+// Takes the storage of other, which must be freed, and leaves other empty.
+void LimbVector::_steal(LimbVector& other) noexcept
 {
-  std::string num = to_string();
-  if (num[0] == '1' && num.find_first_not_of('0', 1) == num.npos)
+  size_ = other.size_;
+  capacity_ = other.capacity_;
+  if (other._inline())
   {
-    return num.size() - 1;
+    std::copy(other.small_, other.small_ + kInlineLimbs, small_);
   }
-  return -1;
+  else
+  {
+    heap_ = other.heap_;
+  }
+  other.size_ = 0;
+  other.capacity_ = kInlineLimbs;
+}
+
+// ============================================================================
+// Constructor / Assignment operator
+
+BigInteger::BigInteger(const char* s)
+  :sign_(kPositive)
+{
+  _string_init(s, std::strlen(s));
+}
+
+BigInteger::BigInteger(const char* s, size_t n)
+  :sign_(kPositive)
+{
+  _string_init(s, n);
+}
+
+BigInteger::BigInteger(std::string_view s)
+  :sign_(kPositive)
+{
+  _string_init(s.data(), s.size());
+}
+
+BigInteger::BigInteger(const BigInteger& other) 
+  :limbs_(other.limbs_), sign_(other.sign_)
+{
+}
+
+BigInteger::BigInteger(BigInteger&& other)
+  :limbs_(std::move(other.limbs_)), sign_(other.sign_)
+{
+  other.limbs_.clear();
+  other.sign_ = kPositive;
+}
+
+BigInteger& BigInteger::operator=(const char* s)
+{
+  BigInteger tmp(s);
+  *this = std::move(tmp);
+  return *this;
+}
+
+BigInteger& BigInteger::operator=(const BigInteger& other)
+{
+  limbs_ = other.limbs_;
+  sign_ = other.sign_;
+  return *this;
+}
+
+BigInteger& BigInteger::operator=(BigInteger&& other)
+{
+  if (this != &other)
+  {
+    limbs_ = std::move(other.limbs_);
+    sign_ = other.sign_;
+    other.limbs_.clear();
+    other.sign_ = kPositive;
+  }
+  return *this;
+}
+
+// ============================================================================
+// Element access.
+
+bool BigInteger::is_positive() const
+{
+  return sign_ == kPositive && !limbs_.empty();
+}
+
+bool BigInteger::is_negative() const
+{
+  return sign_ == kNegative;
+}
+
+bool BigInteger::is_zero() const
+{
+  return limbs_.empty();
+}
+
+bool BigInteger::is_odd() const
+{
+  return !limbs_.empty() && (limbs_[0] & 1) == 1;
+}
+
+bool BigInteger::is_even() const
+{
+  return !is_odd();
+}
+
+int16_t BigInteger::compare(const self & other) const
+{
+  if (sign_ != other.sign_)
+  {
+    return is_negative() ? -1 : 1;
+  }
+  int16_t cmp = _compare(other);
+  return is_negative() ? -cmp : cmp;
+}
+
+size_t BigInteger::digits() const
+{
+  if (limbs_.size() <= 2)
+  {
+    uint64_t n = absolute().to_integer<uint64_t>().first;
+    size_t d = 1;
+    for (; n >= 10; n /= 10, ++d)
+      ; // Empty loop body.
+    return d;
+  }
+  // If x has b bits, 10^(d - 1) <= 2^(b - 1) <= |x| < 10^(d + 1), so x has
+  // d or (d + 1) digits.
+  size_t d = static_cast<size_t>(
+    static_cast<double>(_bit_length() - 1) * 0.30102999566398120) + 1;
+  return _compare(_pow10(d)) >= 0 ? d + 1 : d;
+}
+
+size_t BigInteger::max_digits() const
+{
+  return static_cast<size_t>(-4);
+}
+
+size_t BigInteger::bit_length() const
+{
+  return _bit_length();
+}
+
+bool BigInteger::test_bit(size_t n) const
+{
+  size_t i = n / LIMB_BITS;
+  uint32_t s = static_cast<uint32_t>(n % LIMB_BITS);
+  bool bit = i < limbs_.size() && ((limbs_[i] >> s) & 1) != 0;
+  if (!is_negative())
+  {
+    return bit;
+  }
+  // The bit of ~(|x| - 1), subtracting one flips the bit if the lower bits
+  // are all zero.
+  bool low_zero = i < limbs_.size() && (limbs_[i] & ((1u << s) - 1)) == 0 &&
+    std::all_of(limbs_.begin(), limbs_.begin() + i,
+                [](uint32_t limb) { return limb == 0; });
+  return bit == low_zero;
+}
+
+size_t BigInteger::popcount() const
+{
+  size_t n = 0;
+  for (uint32_t limb : limbs_)
+  {
+    n += limb_popcount(limb);
+  }
+  return n;
+}
+
+BigInteger BigInteger::opposite() const
+{
+  BigInteger result(*this);
+  result.reverse();
+  return result;
+}
+
+BigInteger BigInteger::absolute() const
+{
+  BigInteger result(*this);
+  result.sign_ = kPositive;
+  return result;
+}
+
+BigInteger BigInteger::power(const BigInteger& n) const
+{
+  return _power_of(n);
+}
+
+BigInteger BigInteger::square() const
+{
+  BigInteger result(0);
+  if (!is_zero())
+  {
+    size_t n = limbs_.size();
+    result._grow(n * 2);
+    _multiply(result.limbs_.data(), limbs_.data(), n, limbs_.data(), n);
+    result._trim();
+  }
+  return result;
+}
+
+std::pair<BigInteger, BigInteger>
+BigInteger::divmod(const BigInteger& a, const BigInteger& b)
+{
+  REDBUD_THROW_EX_IF(b.is_zero(), "The divisor can not be zero.");
+  BigInteger q(0);
+  BigInteger r(0);
+  _divide(a, b, q, r);
+  q.sign_ = a.sign_ == b.sign_ ? kPositive : kNegative;
+  r.sign_ = a.sign_;
+  q._trim();
+  r._trim();
+  return std::make_pair(std::move(q), std::move(r));
+}
+
+std::pair<BigInteger, BigInteger>
+BigInteger::floor_divmod(const BigInteger& a, const BigInteger& b)
+{
+  auto qr = divmod(a, b);
+  if (!qr.second.is_zero() && qr.second.sign_ != b.sign_)
+  {
+    --qr.first;
+    qr.second += b;
+  }
+  return qr;
+}
+
+BigInteger BigInteger::gcd(const BigInteger& a, const BigInteger& b)
+{
+  BigInteger x = a.absolute();
+  BigInteger y = b.absolute();
+  _gcd(x, y, nullptr);
+  return x;
+}
+
+BigInteger BigInteger::lcm(const BigInteger& a, const BigInteger& b)
+{
+  if (a.is_zero() || b.is_zero())
+  {
+    return BigInteger(0);
+  }
+  BigInteger result = a.absolute() / gcd(a, b);
+  result._multiply_with_pos(b);
+  return result;
+}
+
+std::tuple<BigInteger, BigInteger, BigInteger>
+BigInteger::extended_gcd(const BigInteger& a, const BigInteger& b)
+{
+  BigInteger g = a.absolute();
+  BigInteger r = b.absolute();
+  // The cofactors of |a|, s[0] * |a| = g and s[1] * |a| = r mod |b|.
+  BigInteger s[2] = { BigInteger(1), BigInteger(0) };
+  _gcd(g, r, s);
+  // The cofactor of |b| is (g - s * |a|) / |b|. The half-GCD steps may
+  // leave |s| greater than |b| / g, which is reduced modulo |b| / g.
+  BigInteger t(0);
+  if (!b.is_zero())
+  {
+    BigInteger k = b.absolute() / g;
+    if (s[0]._compare(k) > 0)
+    {
+      s[0] %= k;
+    }
+    t = g - s[0] * a.absolute();
+    t /= b.absolute();
+  }
+  if (a.is_negative())
+  {
+    s[0].reverse();
+  }
+  if (b.is_negative())
+  {
+    t.reverse();
+  }
+  return std::make_tuple(std::move(g), std::move(s[0]), std::move(t));
+}
+
+BigInteger BigInteger::mod_inverse(const BigInteger& a, const BigInteger& m)
+{
+  REDBUD_THROW_EX_IF(!m.is_positive(), "The modulus must be positive.");
+  BigInteger g = a % m;
+  if (g.is_negative())
+  {
+    g += m;
+  }
+  BigInteger r(m);
+  BigInteger s[2] = { BigInteger(1), BigInteger(0) };
+  _gcd(g, r, s);
+  REDBUD_THROW_EX_IF(g._compare_word(1) != 0, "Not invertible.");
+  if (s[0].is_negative())
+  {
+    s[0] += m;
+  }
+  return s[0] % m;
+}
+
+std::string BigInteger::to_string() const
+{
+  if (is_zero())
+  {
+    return "0";
+  }
+  // The digits are written into one buffer, which is large enough for
+  // log10(2) * bits + 1 digits and the symbol, 0.30103 > log10(2).
+  std::string s(static_cast<size_t>(
+    static_cast<uint64_t>(_bit_length()) * 30103 / 100000) + 3, '\0');
+  char* p = &s[0];
+  if (is_negative())
+  {
+    *p++ = '-';
+  }
+  std::vector<BigInteger> pow(1, BigInteger(DEC_BASE));
+  while (pow.back().limbs_.size() * 2 - 1 <= limbs_.size())
+  {
+    pow.push_back(pow.back().square());
+  }
+  p = _write_decimal(*this, p, 0, pow);
+  s.resize(static_cast<size_t>(p - s.data()));
+  return s;
+}
+
+void BigInteger::print(char sep) const
+{
+  std::fputs(to_string().c_str(), stdout);
+  if (sep != '\0')
+  {
+    std::putchar(sep);
+  }
+}
+
+// ============================================================================
+// Modifiers.
+
+void BigInteger::reverse()
+{
+  if (!is_zero())
+  {
+    sign_ = is_negative() ? kPositive : kNegative;
+  }
+}
+
+BigInteger& BigInteger::addmul(const BigInteger& a, const BigInteger& b)
+{
+  return _addmul(a, b, kPositive);
+}
+
+BigInteger& BigInteger::submul(const BigInteger& a, const BigInteger& b)
+{
+  return _addmul(a, b, kNegative);
+}
+
+BigInteger& BigInteger::shift_digits(ptrdiff_t n)
+{
+  if (n >= 0)
+  {
+    _shift10(static_cast<size_t>(n), kMoveLeft);
+  }
+  else
+  {
+    _shift10(size_t(0) - static_cast<size_t>(n), kMoveRight);
+  }
+  return *this;
+}
+
+BigInteger& BigInteger::truncate_digits(size_t n)
+{
+  _round10(n, false);
+  return *this;
+}
+
+BigInteger& BigInteger::round_digits(size_t n)
+{
+  _round10(n, true);
+  return *this;
+}
+
+void BigInteger::swap(BigInteger& rhs)
+{
+  limbs_.swap(rhs.limbs_);
+  std::swap(sign_, rhs.sign_);
+}
+
+// ============================================================================
+// Overloads operators.
+
+BigInteger& BigInteger::operator+=(const BigInteger& addend)
+{
+  if (sign_ == addend.sign_)
+  {
+    // x + y = x + y, (-x) + (-y) = -(x + y)
+    _plus_with_pos(addend);
+  }
+  else
+  {
+    // x + (-y) = x - y, (-x) + y = -(x - y)
+    _minus_with_pos(addend);
+  }
+  return *this;
+}
+
+BigInteger& BigInteger::operator-=(const BigInteger& subtrahend)
+{
+  if (sign_ != subtrahend.sign_)
+  {
+    // x - (-y) = x + y, (-x) - y = -(x + y)
+    _plus_with_pos(subtrahend);
+  }
+  else
+  {
+    // x - y = x - y, (-x) - (-y) = -(x - y)
+    _minus_with_pos(subtrahend);
+  }
+  return *this;
+}
+
+BigInteger& BigInteger::operator*=(const BigInteger& multiplier)
+{
+  if (is_zero() || multiplier.is_zero())
+  {
+    *this = BigInteger(0);
+    return *this;
+  }
+  SymbolType sign = sign_ == multiplier.sign_ ? kPositive : kNegative;
+  _multiply_with_pos(multiplier);
+  sign_ = sign;
+  return *this;
+}
+
+BigInteger& BigInteger::operator/=(const BigInteger& divisor)
+{
+  *this = std::move(divmod(*this, divisor).first);
+  return *this;
+}
+
+BigInteger& BigInteger::operator%=(const BigInteger& modulus)
+{
+  REDBUD_THROW_EX_IF(modulus.is_zero(), "The modulus can not be zero.");
+  *this = std::move(divmod(*this, modulus).second);
+  return *this;
+}
+
+BigInteger& BigInteger::operator<<=(const BigInteger& n)
+{
+  REDBUD_THROW_EX_IF(n.is_negative(), "Positive required.");
+  if (is_zero())
+  {
+    return *this;
+  }
+  REDBUD_THROW_EX_IF(n.limbs_.size() > 2 ||
+                     n._small() > static_cast<uint64_t>(MAX_LIMBS) * LIMB_BITS,
+                     "Overflow.");
+  _shift_left(static_cast<size_t>(n._small()));
+  return *this;
+}
+
+BigInteger& BigInteger::operator>>=(const BigInteger& n)
+{
+  REDBUD_THROW_EX_IF(n.is_negative(), "Positive required.");
+  bool negative = is_negative();
+  if (n.limbs_.size() > 2 || n._small() >= _bit_length())
+  {
+    *this = BigInteger(negative ? -1 : 0);
+    return *this;
+  }
+  // Shifts the absolute value, then a negative number which loses some set
+  // bits is rounded toward negative infinity, like the two's complement.
+  size_t bits = static_cast<size_t>(n._small());
+  bool inexact = false;
+  if (negative)
+  {
+    const uint32_t* p = limbs_.data();
+    size_t k = bits / LIMB_BITS;
+    unsigned r = static_cast<unsigned>(bits % LIMB_BITS);
+    for (size_t i = 0; i < k && !inexact; ++i)
+    {
+      inexact = p[i] != 0;
+    }
+    inexact = inexact || (r != 0 && (p[k] & ((1u << r) - 1)) != 0);
+  }
+  _shift_right(bits);
+  if (inexact)
+  {
+    *this -= 1;
+  }
+  return *this;
+}
+
+BigInteger& BigInteger::operator&=(const BigInteger& rhs)
+{
+  return _bitwise(rhs, kAnd);
+}
+
+BigInteger& BigInteger::operator|=(const BigInteger& rhs)
+{
+  return _bitwise(rhs, kOr);
+}
+
+BigInteger& BigInteger::operator^=(const BigInteger& rhs)
+{
+  return _bitwise(rhs, kXor);
+}
+
+BigInteger& BigInteger::operator++()
+{
+  if (is_negative())
+  {
+    // -x + 1 = -(x - 1)
+    _decrease();
+  }
+  else
+  {
+    _increase();
+  }
+  return *this;
+}
+
+BigInteger& BigInteger::operator--()
+{
+  if (is_zero())
+  {
+    limbs_.assign(1, 1);
+    sign_ = kNegative;
+  }
+  else if (is_negative())
+  {
+    // -x - 1 = -(x + 1)
+    _increase();
+  }
+  else
+  {
+    _decrease();
+  }
+  return *this;
+}
+
+BigInteger BigInteger::operator++(int)
+{
+  BigInteger tmp(*this);
+  ++*this;
+  return tmp;
+}
+
+BigInteger BigInteger::operator--(int)
+{
+  BigInteger tmp(*this);
+  --*this;
+  return tmp;
+}
+
+BigInteger BigInteger::operator+()
+{
+  return *this;
+}
+
+BigInteger BigInteger::operator-()
+{
+  return opposite();
+}
+
+BigInteger BigInteger::operator~() const
+{
+  BigInteger result(*this);
+  result.reverse();
+  --result;
+  return result;
+}
+
+// ============================================================================
+// Helper functions.
+
+// Clear the zero limbs at the high end, the zero is always positive.
+void BigInteger::_trim()
+{
+  limbs_.resize(limb_normalize(limbs_.data(), limbs_.size()));
+  if (limbs_.empty())
+  {
+    sign_ = kPositive;
+  }
+}
+
+// Resizes to n limbs, the new limbs are zero.
+void BigInteger::_grow(size_t n)
+{
+  REDBUD_THROW_EX_IF(n > MAX_LIMBS, "Overflow.");
+  limbs_.resize(n);
+}
+
+// Returns the number of significant bits of the absolute value.
+size_t BigInteger::_bit_length() const
+{
+  if (is_zero())
+  {
+    return 0;
+  }
+  return (limbs_.size() - 1) * LIMB_BITS + limb_bits(limbs_.back());
+}
+
+// An integer should satisfy the following rules:
+//   1. It can have at most one sign.
+//   2. No extra zero can appear in front of the number.
+//   3. Numbers can be expressed in general notation or standard 
+//      scientific notation "a*10^b"(aEb), where 1<= |a| < 10 and b >= 1.
+//
+// The regular expression to match an integer string looks like this:
+//   r```("^[+-]?"                              # sign
+//        "(0|"                                 # 0
+//        "[1-9]\d*|"                           # positive integer
+//        "[1-9](\.\d+)?[eE]\+?[1-9]\d*)$")```  # scientific notation
+//
+// The string is checked and its digits are located in one pass, it does not
+// need to be null-terminated.
+void BigInteger::_string_init(const char* s, size_t n)
+{
+  const char* p = s;
+  const char* end = s + n;
+  SymbolType sign = kPositive;
+  if (p != end && (*p == '+' || *p == '-'))
+  {
+    sign = *p++ == '-' ? kNegative : kPositive;
+  }
+  REDBUD_THROW_EX_IF(p == end || *p < '0' || *p > '9', "Invalid expression.");
+  if (*p == '0')
+  {
+    // Matches zero.
+    REDBUD_THROW_EX_IF(p + 1 != end, "Invalid expression.");
+    limbs_.clear();
+    sign_ = kPositive;
+    return;
+  }
+  const char* first = p;
+  for (++p; p != end && '0' <= *p && *p <= '9'; ++p)
+    ; // Empty loop body
+  std::vector<BigInteger> pow;
+  if (p == end)
+  {
+    // Matches the positive integer.
+    *this = _read_decimal(first, static_cast<size_t>(end - first), pow);
+    sign_ = sign;
+    return;
+  }
+
+  // Matches the integer of scientific notation "a.bEn", which is read as
+  // the integer "ab" and shifts left (n - the number of digits of b) digits.
+  REDBUD_THROW_EX_IF(p != first + 1, "Invalid expression.");
+  size_t fraction = 0;
+  if (*p == '.')
+  {
+    const char* f = ++p;
+    for (; p != end && '0' <= *p && *p <= '9'; ++p)
+      ; // Empty loop body
+    REDBUD_THROW_EX_IF(p == f, "Invalid expression.");
+    fraction = static_cast<size_t>(p - f);
+  }
+  REDBUD_THROW_EX_IF(p == end || (*p != 'e' && *p != 'E'),
+                     "Invalid expression.");
+  if (++p != end && *p == '+')
+  {
+    ++p;
+  }
+  REDBUD_THROW_EX_IF(p == end || *p < '1' || *p > '9', "Invalid expression.");
+  uint64_t shift = 0;
+  for (; p != end && '0' <= *p && *p <= '9'; ++p)
+  {
+    // Stops growing once it overflows, which is reported by _shift10.
+    if (shift <= MAX_DIGITS)
+    {
+      shift = shift * 10 + static_cast<uint64_t>(*p - '0');
+    }
+  }
+  REDBUD_THROW_EX_IF(p != end, "Invalid expression.");
+  REDBUD_THROW_EX_IF(shift < fraction, "Not an integer string.");
+  if (fraction == 0)
+  {
+    *this = _read_decimal(first, 1, pow);
+  }
+  else
+  {
+    std::string digits(first, 1);
+    digits.append(first + 2, fraction);
+    *this = _read_decimal(digits.data(), digits.size(), pow);
+  }
+  shift -= fraction;
+  _shift10(static_cast<size_t>(std::min<uint64_t>(shift, MAX_DIGITS + 1ull)),
+           kMoveLeft);
+  sign_ = sign;
 }
 
-// An integer should satisfy the following rules:
-//   1. It can have at most one sign.
-//   2. No extra zero can appear in front of the number.
-//   3. Numbers can be expressed in general notation or standard 
-//      scientific notation "a*10^b"(aEb), where 1<= |a| < 10 and b >= 1.
-//
-// The regular expression to match an integer string looks like this:
-//   r```("^[+-]?"                              # sign
-//        "(0|"                                 # 0
-//        "[1-9]\d*|"                           # positive integer
-//        "[1-9](\.\d+)?[eE]\+?[1-9]\d*)$")```  # scientific notation
-NumberType BigInteger::_is_integer(const char* sz)
+// Initialize with numeric literal.
+void BigInteger::_integer_init(uint64_t n, SymbolType negative)
 {
-  if (*sz == '+' || *sz == '-')
+  limbs_.clear();
+  for (; n != 0; n >>= LIMB_BITS)
   {
-    sz++;
+    limbs_.push_back(static_cast<uint32_t>(n));
   }
-  if (*sz == '0')
+  sign_ = limbs_.empty() ? kPositive : negative;
+}
+
+// The absolute value becomes (|this| * m + a).
+void BigInteger::_mul_add(uint64_t m, uint64_t a)
+{
+  size_t size = limbs_.size();
+  uint64_t carry = limb_mul_add_2(limbs_.data(), limbs_.data(), size, m, a);
+  if (carry != 0)
   {
-    // Matches zero.
-    REDBUD_THROW_EX_IF(*(sz + 1) != '\0', "Invalid expression.");
-    return kZero;
+    _grow(size + 2);
+    limbs_[size] = static_cast<uint32_t>(carry);
+    limbs_[size + 1] = static_cast<uint32_t>(carry >> LIMB_BITS);
   }
-  else
+  _trim();
+}
+
+// Adds one to the absolute value.
+void BigInteger::_increase()
+{
+  for (auto& limb : limbs_)
   {
-    REDBUD_THROW_EX_IF(*sz < '1' || *sz > '9', "Invalid expression.");
-    sz++;
-    if (*sz == '.' || *sz == 'e' || *sz == 'E')
+    if (++limb != 0)
     {
-      // Matches the integer of scientific notation.
-      if (*sz == '.')
-      {
-        sz++;
-        REDBUD_THROW_EX_IF(*sz < '0' || *sz > '9', "Invalid expression.");
-        for (sz++; '0' <= *sz && *sz <= '9'; sz++)
-          ; // Empty loop body
-      }
-      sz++;
-      if (*sz == '+')
-      {
-        sz++;
-      }
-      REDBUD_THROW_EX_IF(*sz < '1' || *sz > '9', "Invalid expression.");
-      for (sz++; '0' <= *sz && *sz <= '9'; sz++)
-        ; // Empty loop body
-      REDBUD_THROW_EX_IF(*sz != '\0', "Invalid expression.");
-      return kScientificNotation;
+      return;
     }
-    else
+  }
+  _grow(limbs_.size() + 1);
+  limbs_.back() = 1;
+}
+
+// Subtracts one from the absolute value, which can not be zero.
+void BigInteger::_decrease()
+{
+  for (auto& limb : limbs_)
+  {
+    if (limb-- != 0)
     {
-      for (; '0' <= *sz && *sz <= '9'; sz++)
-        ; // Empty loop body
-      REDBUD_THROW_EX_IF(*sz != '\0', "Invalid expression.");
-      return kPositiveInteger;
+      break;
     }
   }
+  _trim();
 }
 
-// Initialize with numeric literal.
-void BigInteger::_integer_init(uint64_t n, SymbolType negative)
+// Returns the absolute value, which has at most two limbs.
+uint64_t BigInteger::_small() const
 {
-  if (n == 0)
+  uint64_t n = limbs_.empty() ? 0 : limbs_[0];
+  if (limbs_.size() == 2)
   {
-    _group_push(static_cast<int16_t>(0));
-    return;
+    n |= static_cast<uint64_t>(limbs_[1]) << LIMB_BITS;
+  }
+  return n;
+}
+
+// Sets the absolute value to n, the symbol is not changed unless n is zero.
+void BigInteger::_set_small(uint64_t n)
+{
+  limbs_.resize(2);
+  limbs_[0] = static_cast<uint32_t>(n);
+  limbs_[1] = static_cast<uint32_t>(n >> LIMB_BITS);
+  _trim();
+}
+
+// Compares the absolute values.
+int16_t BigInteger::_compare(const BigInteger& rhs) const
+{
+  return limb_compare(limbs_.data(), limbs_.size(),
+                      rhs.limbs_.data(), rhs.limbs_.size());
+}
+
+// The following functions work on the absolute values, the symbol of the
+// result is the same as this BigInteger, unless it is noted.
+
+BigInteger& BigInteger::_plus_with_pos(const BigInteger& addend)
+{
+  if (addend.limbs_.size() <= 2)
+  {
+    return _plus_word(addend._small());
   }
-  while (n)
+  size_t n = addend.limbs_.size();
+  if (limbs_.size() < n)
   {
-    _group_push(static_cast<int16_t>(n % 10000));
-    n /= 10000;
+    _grow(n);
   }
-  if (negative)
+  uint32_t carry = limb_add(limbs_.data(), limbs_.data(), limbs_.size(),
+                            addend.limbs_.data(), n);
+  if (carry != 0)
   {
-    _symbol_neg();
+    _grow(limbs_.size() + 1);
+    limbs_.back() = carry;
   }
+  return *this;
 }
 
-// Initialize with string literal.
-void BigInteger::_string_init(const char* sz)
+// The symbol is reversed if the subtrahend is greater.
+BigInteger& BigInteger::_minus_with_pos(const BigInteger& subtrahend)
 {
-  NumberType t = _is_integer(sz);
-  if (t == kZero)
+  if (subtrahend.limbs_.size() <= 2)
   {
-    number_.push_back(0);
-    return;
+    return _minus_word(subtrahend._small());
+  }
+  int16_t cmp = _compare(subtrahend);
+  if (cmp == 0)
+  {
+    *this = BigInteger(0);
+    return *this;
+  }
+  const value_type& b = subtrahend.limbs_;
+  if (cmp > 0)
+  {
+    limb_sub(limbs_.data(), limbs_.data(), limbs_.size(), b.data(), b.size());
+  }
+  else
+  {
+    // The larger one minus the smaller one.
+    value_type diff(b.size());
+    limb_sub(diff.data(), b.data(), b.size(), limbs_.data(), limbs_.size());
+    limbs_.swap(diff);
+    reverse();
+  }
+  _trim();
+  return *this;
+}
+
+BigInteger& BigInteger::_multiply_with_pos(const BigInteger& m)
+{
+  if (m.limbs_.size() <= 2)
+  {
+    return _multiply_word(m._small());
+  }
+  if (limbs_.size() <= 2)
+  {
+    uint64_t n = _small();
+    limbs_.reserve(m.limbs_.size() + 2);
+    limbs_ = m.limbs_;
+    return _multiply_word(n);
+  }
+  // The limbs of result is less than or equal to the sum of two multiplier.
+  BigInteger result(0);
+  result._grow(limbs_.size() + m.limbs_.size());
+  _multiply(result.limbs_.data(), limbs_.data(), limbs_.size(),
+            m.limbs_.data(), m.limbs_.size());
+  limbs_.swap(result.limbs_);
+  _trim();
+  return *this;
+}
+
+// The following functions work on the absolute value and a word, which are
+// used by the operators with an integer and the fast paths above.
+
+BigInteger& BigInteger::_plus_word(uint64_t n)
+{
+  size_t size = limbs_.size();
+  if (size <= 2)
+  {
+    uint64_t a = _small();
+    uint64_t sum = a + n;
+    limbs_.resize(3);
+    limbs_[0] = static_cast<uint32_t>(sum);
+    limbs_[1] = static_cast<uint32_t>(sum >> LIMB_BITS);
+    limbs_[2] = sum < a ? 1 : 0;
+    _trim();
+    return *this;
   }
-  bool result_neg = false;
-  if (*sz == '+' || *sz == '-')
+  const uint32_t w[2] = { static_cast<uint32_t>(n),
+                          static_cast<uint32_t>(n >> LIMB_BITS) };
+  uint32_t carry = limb_add(limbs_.data(), limbs_.data(), size, w, 2);
+  if (carry != 0)
   {
-    result_neg = *sz == '-';
-    sz++;
+    _grow(size + 1);
+    limbs_.back() = carry;
   }
+  return *this;
+}
 
-  if (t == kPositiveInteger)
+// The symbol is reversed if n is greater.
+BigInteger& BigInteger::_minus_word(uint64_t n)
+{
+  size_t size = limbs_.size();
+  if (size <= 2)
   {
-    // Initialize with a positive integer.
-    size_t i = strlen(sz);
-    for (; 4 < i; i -= 4)
+    uint64_t a = _small();
+    _set_small(a >= n ? a - n : n - a);
+    if (a < n)
     {
-      _group_push(GROUP_NUM(sz, i));
+      reverse();
     }
-    int16_t num = 0;
-    for (int16_t m = 1; i > 0; --i, m *= 10)
+    return *this;
+  }
+  const uint32_t w[2] = { static_cast<uint32_t>(n),
+                          static_cast<uint32_t>(n >> LIMB_BITS) };
+  limb_sub(limbs_.data(), limbs_.data(), size, w, 2);
+  _trim();
+  return *this;
+}
+
+BigInteger& BigInteger::_multiply_word(uint64_t n)
+{
+  size_t size = limbs_.size();
+  uint32_t lo = static_cast<uint32_t>(n);
+  uint32_t hi = static_cast<uint32_t>(n >> LIMB_BITS);
+  if (hi == 0)
+  {
+    uint32_t carry = limb_mul_add_1(limbs_.data(), limbs_.data(), size,
+                                    lo, 0);
+    if (carry != 0)
     {
-      num += BITNUM(*(sz + i - 1), m);
+      _grow(size + 1);
+      limbs_.back() = carry;
     }
-    _group_push(num);
+    _trim();
+    return *this;
   }
-  else
+  _mul_add(n, 0);
+  return *this;
+}
+
+// Returns the remainder, the divisor can not be zero.
+uint64_t BigInteger::_divide_word(uint64_t n)
+{
+  REDBUD_THROW_EX_IF(n == 0, "The divisor can not be zero.");
+  if (limbs_.size() <= 2)
   {
-    // Initialize with scientific notation.
-    size_t exp = 0;
-    size_t i = strlen(sz);
-    for (; '0' <= *(sz + i - 1) && *(sz + i - 1) <= '9'; --i)
-      ; // Empty loop body
-    size_t shift = strtoul(sz + i, nullptr, 10);
-    // TODO: do not use for
-    for (; *(sz + i - 1) < '0' || *(sz + i - 1) > '9'; exp = i, --i)
-      ; // Empty loop body
-    if (i == 1)
-    { // xen = x * 10^n
-      _group_push(*sz - '0');
-      _shift10(shift, kMoveLeft);
+    uint64_t a = _small();
+    _set_small(a / n);
+    return a % n;
+  }
+  if (n >> LIMB_BITS == 0)
+  {
+    uint32_t r = limb_div_1(limbs_.data(), limbs_.data(), limbs_.size(),
+                            static_cast<uint32_t>(n));
+    _trim();
+    return r;
+  }
+  // A divisor of two limbs goes to the long division.
+  BigInteger q(0);
+  BigInteger r(0);
+  _divide(*this, BigInteger(n), q, r);
+  limbs_.swap(q.limbs_);
+  _trim();
+  return r._small();
+}
+
+// Returns the remainder without the quotient.
+uint64_t BigInteger::_mod_word(uint64_t n) const
+{
+  REDBUD_THROW_EX_IF(n == 0, "The modulus can not be zero.");
+  if (limbs_.size() <= 2)
+  {
+    return _small() % n;
+  }
+  if (n >> LIMB_BITS == 0)
+  {
+    uint64_t r = 0;
+    for (size_t i = limbs_.size(); i-- > 0; )
+    {
+      r = ((r << LIMB_BITS) | limbs_[i]) % n;
     }
-    else
+    return r;
+  }
+  BigInteger q(0);
+  BigInteger r(0);
+  _divide(*this, BigInteger(n), q, r);
+  return r._small();
+}
+
+int16_t BigInteger::_compare_word(uint64_t n) const
+{
+  if (limbs_.size() > 2)
+  {
+    return 1;
+  }
+  uint64_t a = _small();
+  return a < n ? -1 : (a > n ? 1 : 0);
+}
+
+// Returns the value of the decimal digits p[0, n). pow[k] is 10^(19 * 2^k),
+// which is computed on the first use.
+//
+// The high part is multiplied by the power of the low part, so the parsing
+// costs O(M(n) log(n)).
+BigInteger BigInteger::_read_decimal(const char* p, size_t n,
+                                     std::vector<BigInteger>& pow)
+{
+  if (n <= FROM_STRING_THRESHOLD)
+  {
+    // Reads 19 digits each time, the first time reads the rest.
+    BigInteger result(0);
+    for (size_t len = (n - 1) % 19 + 1; n > 0; p += len, n -= len, len = 19)
     {
-      for (; 5 < i; i -= 4)
-      {
-        _group_push(GROUP_NUM(sz, i));
-      }
-      int16_t num = 0;
-      for (int16_t m = 1; i > 0; --i)
+      uint64_t chunk = 0;
+      for (size_t i = 0; i < len; ++i)
       {
-        if (*(sz + i - 1) == '.')
-        {
-          continue;
-        }
-        num += BITNUM(*(sz + i - 1), m);
-        m *= 10;
+        chunk = chunk * 10 + static_cast<uint64_t>(p[i] - '0');
       }
-      _group_push(num);
-      // Notes that the exp is at least 3.
-      REDBUD_THROW_EX_IF(shift < exp - 3, "Not an integer string.");
-      _shift10(shift - (exp - 3), kMoveLeft);
+      result._mul_add(kPow10[len], chunk);
+    }
+    return result;
+  }
+  // The low part has 19 * 2^k digits, which is not less than the high part.
+  size_t k = 0;
+  while ((static_cast<size_t>(19) << (k + 1)) < n)
+  {
+    ++k;
+  }
+  if (pow.empty())
+  {
+    pow.push_back(BigInteger(kPow10[19]));
+  }
+  while (pow.size() <= k)
+  {
+    pow.push_back(pow.back().square());
+  }
+  size_t low = static_cast<size_t>(19) << k;
+  BigInteger result = _read_decimal(p, n - low, pow);
+  result._multiply_with_pos(pow[k]);
+  return result._plus_with_pos(_read_decimal(p + n - low, low, pow));
+}
+
+// Writes the digits of |x| from p and returns the end of them. If width is
+// not zero, exactly width digits are written with the leading zeros, and
+// |x| must be less than 10^width. pow[k] is 10^(9 * 2^k).
+//
+// The number is split into the high and the low half by pow[k], and each
+// half is written recursively, so the conversion costs O(M(n) log(n)).
+char* BigInteger::_write_decimal(const BigInteger& x, char* p, size_t width,
+                                 const std::vector<BigInteger>& pow)
+{
+  size_t n = x.limbs_.size();
+  if (n <= TO_STRING_THRESHOLD)
+  {
+    // Gets 9 digits each time from low to high into a local buffer.
+    uint32_t a[TO_STRING_THRESHOLD];
+    char buf[TO_STRING_THRESHOLD * 10 + DEC_DIGITS];
+    char* end = buf + sizeof(buf);
+    char* q = end;
+    std::copy(x.limbs_.begin(), x.limbs_.end(), a);
+    for (; n > 0; n = limb_normalize(a, n))
+    {
+      q -= DEC_DIGITS;
+      write_dec9(q, limb_div_dec(a, a, n));
+    }
+    while (q != end && *q == '0')
+    {
+      ++q;
+    }
+    size_t len = static_cast<size_t>(end - q);
+    if (width > len)
+    {
+      p = std::fill_n(p, width - len, '0');
     }
+    return std::copy(q, end, p);
   }
-  if (result_neg)
+  size_t k = 0;
+  if (width == 0)
   {
-    _symbol_neg();
+    // The largest power which is not greater than x, so the high half is
+    // not zero.
+    for (k = pow.size() - 1; k > 0 && x._compare(pow[k]) < 0; --k)
+      ; // Empty loop body
+  }
+  else
+  {
+    while ((static_cast<size_t>(DEC_DIGITS) << (k + 1)) < width)
+    {
+      ++k;
+    }
   }
+  size_t low = static_cast<size_t>(DEC_DIGITS) << k;
+  BigInteger q(0);
+  BigInteger r(0);
+  _divide(x, pow[k], q, r);
+  p = _write_decimal(q, p, width == 0 ? 0 : width - low, pow);
+  return _write_decimal(r, p, low, pow);
 }
 
-// The BigInteger calls this function must be non-negative.
-// The nth group adds the value on the original basis and 
-// returns true if it has a carry.
-inline bool BigInteger::_add_and_carry(size_t n, int16_t value)
+// Adds a * b to this BigInteger if op is kPositive, otherwise subtracts it.
+BigInteger& BigInteger::_addmul(const BigInteger& a, const BigInteger& b,
+                                SymbolType op)
 {
-  REDBUD_THROW_EX_IF(n >= MAX_GROUPS &&
-                     number_[n] + value > 9999, "Overflow.");
-  if (n == number_.size())
+  if (a.is_zero() || b.is_zero())
   {
-    number_.push_back(value);
-    return false;
+    return *this;
   }
-  // 0 <= number_[n], value < 10000
-  // if value + number_[n] < 10000
-  //    number_[n] = value + number_[n] >= value
-  // if value + number_[n] >= 10000
-  //    number_[n] = value + number_[n] - 10000 
-  //               = value - (10000 - number_[n]) < value
-  number_[n] = MOD(number_[n] + value);
-  return number_[n] < value;
+  SymbolType sign = (a.sign_ == b.sign_) == (op == kPositive)
+    ? kPositive : kNegative;
+  const BigInteger& x = a.limbs_.size() >= b.limbs_.size() ? a : b;
+  const BigInteger& y = a.limbs_.size() >= b.limbs_.size() ? b : a;
+  if (y.limbs_.size() > 2 || &a == this || &b == this ||
+      (!is_zero() && sign_ != sign))
+  {
+    BigInteger product(x * y);
+    return op == kPositive ? *this += product : *this -= product;
+  }
+  // The absolute values are added, so accumulates x * y limb by limb.
+  size_t xn = x.limbs_.size();
+  size_t n = std::max(limbs_.size(), xn + 2) + 1;
+  _grow(n);
+  uint32_t* r = limbs_.data();
+  for (size_t i = 0; i < y.limbs_.size(); ++i)
+  {
+    uint32_t c = limb_addmul_1(r + i, x.limbs_.data(), xn, y.limbs_[i]);
+    limb_add(r + i + xn, r + i + xn, n - i - xn, &c, 1);
+  }
+  sign_ = sign;
+  _trim();
+  return *this;
 }
 
-std::string BigInteger::_group_to_string(size_t n) const
+BigInteger BigInteger::_power_of(const BigInteger& n) const
 {
-  if (n == _group_size() - 1)
+  REDBUD_THROW_EX_IF(is_zero() && !n.is_positive(), "Invalid value.");
+  bool unit = limbs_.size() == 1 && limbs_[0] == 1;
+  if (is_zero() || (!unit && n.is_negative()))
+  {
+    return BigInteger(0);
+  }
+  if (n.is_zero() || (unit && (!is_negative() || n.is_even())))
+  { // x^0, x != 0 || 1^n || (-1)^n, n is even
+    return BigInteger(1);
+  }
+  if (unit)
+  { // (-1)^n, n is odd
+    return BigInteger(-1);
+  }
+  if (n.limbs_.size() == 1 && n.limbs_[0] == 1)
+  { // x^1
+    return BigInteger(*this);
+  }
+
+  auto pair = n.to_integer<uint64_t>();
+  REDBUD_THROW_EX_IF(pair.second == false, "Overflow.");
+  const uint64_t e = pair.first;
+  const uint64_t max_bits = static_cast<uint64_t>(MAX_LIMBS) * LIMB_BITS;
+  REDBUD_THROW_EX_IF(e > (max_bits - 1) / (_bit_length() - 1), "Overflow.");
+
+  // Left-to-right sliding window exponentiation. Precomputes the odd powers
+  // x, x^3, ..., x^(2^k - 1), then each window of at most k bits ending with
+  // a bit of 1 costs a multiplication, and each bit costs a squaring.
+  size_t ebits = 0;
+  for (uint64_t t = e; t != 0; t >>= 1)
   {
-    return std::to_string(_group(n));
+    ++ebits;
   }
-  int16_t num = _group(n);
-  std::string str;
-  if (num < 10)
+  size_t k = ebits > 671 ? 6 : ebits > 239 ? 5 : ebits > 79 ? 4
+    : ebits > 23 ? 3 : ebits > 6 ? 2 : 1;
+  std::vector<BigInteger> odd(1, absolute());
+  if (k > 1)
   {
-    str += "000";
+    BigInteger x2 = odd[0].square();
+    for (size_t i = 1; i < (size_t(1) << (k - 1)); ++i)
+    {
+      odd.push_back(odd.back() * x2);
+    }
   }
-  else if (num < 100)
+  BigInteger result(1);
+  bool first = true;
+  for (size_t i = ebits; i-- > 0; )
   {
-    str += "00";
+    if (((e >> i) & 1) == 0)
+    {
+      result = result.square();
+      continue;
+    }
+    size_t j = i + 1 < k ? 0 : i + 1 - k;
+    for (; ((e >> j) & 1) == 0; ++j)
+      ; // Empty loop body.
+    size_t window = static_cast<size_t>((e >> j) & ((2u << (i - j)) - 1));
+    if (first)
+    {
+      result = odd[window >> 1];
+      first = false;
+    }
+    else
+    {
+      for (size_t l = j; l <= i; ++l)
+      {
+        result = result.square();
+      }
+      result *= odd[window >> 1];
+    }
+    i = j;
   }
-  else if (num < 1000)
+  if (is_negative() && (e & 1) != 0)
   {
-    str += "0";
+    result.reverse();
   }
-  str += std::to_string(num);
-  return str;
+  return result;
 }
 
-int16_t BigInteger::_compare(const BigInteger& rhs) const
+// Shift int the decimal system(base 10).
+void BigInteger::_shift10(size_t n, ShiftType direction)
 {
-  int32_t i = _group_size() - 1;
-  int32_t j = rhs._group_size() - 1;
-  if (i != j)
+  if (is_zero() || n == 0)
+  {
+    return;
+  }
+  if (direction == kMoveLeft)
   {
-    return j < i ? 1 : -1;
+    REDBUD_THROW_EX_IF(n > MAX_DIGITS, "Overflow.");
+    _multiply_with_pos(_pow10(n));
+    return;
   }
-  for (; i >= 0; --i, --j)
+  // |x| < 2^b <= 10^d, so it becomes zero if n >= d.
+  size_t d = static_cast<size_t>(
+    static_cast<double>(_bit_length()) * 0.30102999566398120) + 1;
+  if (n >= d)
   {
-    if (_group(i) > rhs._group(j))
+    *this = BigInteger(0);
+    return;
+  }
+  if (n <= 4 * DEC_DIGITS)
+  { // Divides by at most 10^9 each time.
+    for (size_t k = 0; n > 0; n -= k)
     {
-      return 1;
+      k = std::min<size_t>(n, DEC_DIGITS);
+      limb_div_1(limbs_.data(), limbs_.data(), limbs_.size(),
+                 static_cast<uint32_t>(kPow10[k]));
+      _trim();
     }
-    if (rhs._group(i) > _group(j))
+  }
+  else
+  {
+    BigInteger q(0);
+    BigInteger r(0);
+    _divide(*this, _pow10(n), q, r);
+    limbs_.swap(q.limbs_);
+  }
+  if (is_zero())
+  {
+    sign_ = kPositive;
+  }
+}
+
+// Keeps the n most significant decimal digits, and the others are set to
+// zero, rounds half away from zero if nearest is true, otherwise truncates.
+void BigInteger::_round10(size_t n, bool nearest)
+{
+  size_t d = digits();
+  if (is_zero() || d <= n)
+  {
+    return;
+  }
+  BigInteger unit = _pow10(d - n);
+  BigInteger q(0);
+  BigInteger r(0);
+  _divide(*this, unit, q, r);
+  if (nearest)
+  {
+    r._shift_left(1);
+    if (r._compare(unit) >= 0)
     {
-      return -1;
+      q._plus_word(1);
     }
   }
-  return 0;
+  q._multiply_with_pos(unit);
+  limbs_.swap(q.limbs_);
+  if (is_zero())
+  {
+    sign_ = kPositive;
+  }
 }
 
+// Shifts the absolute value left by bits.
+void BigInteger::_shift_left(size_t bits)
+{
+  if (is_zero() || bits == 0)
+  {
+    return;
+  }
+  size_t n = limbs_.size();
+  size_t k = bits / LIMB_BITS;
+  _grow(n + k + 1);
+  uint32_t* p = limbs_.data();
+  p[n + k] = limb_lshift(p + k, p, n, static_cast<unsigned>(bits % LIMB_BITS));
+  std::fill(p, p + k, 0u);
+  _trim();
+}
 
-BigInteger& BigInteger::_plus_with_pos(const BigInteger& addend)
+// Shifts the absolute value right by bits, the bits shifted out are lost.
+void BigInteger::_shift_right(size_t bits)
 {
-  if (addend.is_zero())
+  size_t n = limbs_.size();
+  size_t k = bits / LIMB_BITS;
+  if (k >= n)
   {
-    return *this;
+    *this = BigInteger(0);
+    return;
   }
-  if (is_zero())
+  uint32_t* p = limbs_.data();
+  limb_rshift(p, p + k, n - k, static_cast<unsigned>(bits % LIMB_BITS));
+  limbs_.resize(n - k);
+  _trim();
+}
+
+// The bitwise operation in two's complement.
+BigInteger& BigInteger::_bitwise(const BigInteger& rhs, BitwiseType type)
+{
+  size_t an = limbs_.size();
+  size_t bn = rhs.limbs_.size();
+  bool na = is_negative();
+  bool nb = rhs.is_negative();
+  size_t n = std::max(an, bn) + 1;
+  _grow(n);
+  uint32_t* r = limbs_.data();
+  const uint32_t* b = rhs.limbs_.data();
+  bool negative = false;
+  switch (type)
+  {
+    case kAnd:
+      negative = limb_bitwise(r, r, an, na, b, bn, nb, n,
+        [](uint32_t x, uint32_t y) { return x & y; });
+      break;
+    case kOr:
+      negative = limb_bitwise(r, r, an, na, b, bn, nb, n,
+        [](uint32_t x, uint32_t y) { return x | y; });
+      break;
+    case kXor:
+      negative = limb_bitwise(r, r, an, na, b, bn, nb, n,
+        [](uint32_t x, uint32_t y) { return x ^ y; });
+      break;
+  }
+  sign_ = negative ? kNegative : kPositive;
+  _trim();
+  return *this;
+}
+
+// Returns 10^n.
+BigInteger BigInteger::_pow10(size_t n)
+{
+  return BigInteger(10).power(n);
+}
+
+// Returns a non-negative BigInteger of the limbs p[0, n).
+BigInteger BigInteger::_from_limbs(const uint32_t* p, size_t n)
+{
+  BigInteger result(0);
+  result.limbs_.assign(p, p + limb_normalize(p, n));
+  return result;
+}
+
+// r[0, an + bn) = a[0, an) * b[0, bn), r can not overlap a or b. Chooses
+// the algorithm by the size of the shorter operand, and an unbalanced
+// multiplication is split into the balanced ones. If a and b are the same,
+// each algorithm computes a square.
+void BigInteger::_multiply(uint32_t* r, const uint32_t* a, size_t an,
+                           const uint32_t* b, size_t bn)
+{
+  if (an < bn)
+  {
+    std::swap(a, b);
+    std::swap(an, bn);
+  }
+  if (a == b && an == bn && an < KARATSUBA_THRESHOLD)
+  {
+    limb_sqr_basecase(r, a, an);
+  }
+  else if (bn < KARATSUBA_THRESHOLD)
+  {
+    limb_mul_basecase(r, a, an, b, bn);
+  }
+  else if (bn <= (an + 1) / 2)
+  {
+    // Multiplies b by each bn limbs of a, and adds the products together.
+    std::fill(r, r + an + bn, 0u);
+    std::vector<uint32_t> product(bn * 2);
+    for (size_t i = 0; i < an; i += bn)
+    {
+      size_t n = std::min(bn, an - i);
+      _multiply(product.data(), a + i, n, b, bn);
+      limb_add(r + i, r + i, an + bn - i, product.data(), n + bn);
+    }
+  }
+  else if (bn < TOOM3_THRESHOLD || bn <= (an + 2) / 3 * 2)
+  {
+    _karatsuba(r, a, an, b, bn);
+  }
+  else if (bn < NTT_THRESHOLD || an + bn > NTT_MAX_SIZE)
+  {
+    _toom3(r, a, an, b, bn);
+  }
+  else
+  {
+    limb_mul_ntt(r, a, an, b, bn);
+  }
+}
+
+// Karatsuba multiplication, requires an >= bn > ceil(an / 2).
+// Let a = a1 * x + a0, b = b1 * x + b0, where x = 2^(32 * h), then
+//   a * b = a1 * b1 * x^2 + ((a0 + a1) * (b0 + b1) - a0 * b0 - a1 * b1) * x
+//         + a0 * b0
+void BigInteger::_karatsuba(uint32_t* r, const uint32_t* a, size_t an,
+                            const uint32_t* b, size_t bn)
+{
+  size_t h = (an + 1) / 2;
+  size_t n = an + bn;
+  _multiply(r, a, h, b, h);
+  _multiply(r + h * 2, a + h, an - h, b + h, bn - h);
+
+  std::vector<uint32_t> buf((h + 1) * 4);
+  uint32_t* sa = buf.data();
+  uint32_t* sb = sa + h + 1;
+  uint32_t* t = sb + h + 1;
+  sa[h] = limb_add(sa, a, h, a + h, an - h);
+  if (a == b && an == bn)
   {
-    *this = addend;
-    return *this;
+    sb = sa;
   }
-
-  int16_t carry = 0;
-  size_t i = 0;
-  for (; i < _group_size() && i < addend._group_size(); ++i)
+  else
   {
-    int16_t sum = _group(i) + addend._group(i) + carry;
-    _group_adjust(i, MOD(sum));
-    carry = DIV(sum);
+    sb[h] = limb_add(sb, b, h, b + h, bn - h);
+  }
+  _multiply(t, sa, h + 1, sb, h + 1);
+  limb_sub(t, t, h * 2 + 2, r, h * 2);
+  limb_sub(t, t, h * 2 + 2, r + h * 2, n - h * 2);
+  limb_add(r + h, r + h, n - h, t, limb_normalize(t, h * 2 + 2));
+}
+
+// Toom-3 multiplication, requires an >= bn > 2 * ceil(an / 3).
+// Splits the operands into three parts, a(x) = a2 * x^2 + a1 * x + a0 and
+// so is b(x), evaluates the product at 0, 1, -1, 2 and infinity, then
+// interpolates the five coefficients by Bodrato's sequence.
+void BigInteger::_toom3(uint32_t* r, const uint32_t* a, size_t an,
+                        const uint32_t* b, size_t bn)
+{
+  size_t k = (an + 2) / 3;
+  BigInteger a0 = _from_limbs(a, k);
+  BigInteger a1 = _from_limbs(a + k, k);
+  BigInteger a2 = _from_limbs(a + k * 2, an - k * 2);
+
+  // Evaluation.
+  BigInteger t = a0 + a2;
+  BigInteger pa1 = t + a1;                // a(1)
+  BigInteger pam = t - a1;                // a(-1)
+  BigInteger pa2 = pam + a2;
+  pa2 += pa2;
+  pa2 -= a0;                              // a(2) = 2 * (a(-1) + a2) - a0
+
+  // Pointwise multiplication.
+  BigInteger c0(0);                       // r(0)
+  BigInteger c1(0);                       // r(1)
+  BigInteger c2(0);                       // r(-1)
+  BigInteger c3(0);                       // r(2)
+  BigInteger c4(0);                       // r(infinity)
+  if (a == b && an == bn)
+  {
+    c0 = a0.square();
+    c1 = pa1.square();
+    c2 = pam.square();
+    c3 = pa2.square();
+    c4 = a2.square();
   }
-  for (; i < _group_size(); ++i)
+  else
   {
-    int16_t sum = _group(i) + carry;
-    _group_adjust(i, MOD(sum));
-    carry = DIV(sum);
+    BigInteger b0 = _from_limbs(b, k);
+    BigInteger b1 = _from_limbs(b + k, k);
+    BigInteger b2 = _from_limbs(b + k * 2, bn - k * 2);
+    t = b0 + b2;
+    BigInteger pb1 = t + b1;
+    BigInteger pbm = t - b1;
+    BigInteger pb2 = pbm + b2;
+    pb2 += pb2;
+    pb2 -= b0;
+    c0 = a0 * b0;
+    c1 = pa1 * pb1;
+    c2 = pam * pbm;
+    c3 = pa2 * pb2;
+    c4 = a2 * b2;
+  }
+
+  // Interpolation, all the divisions are exact.
+  c3 = (c3 - c1) / BigInteger(3);
+  c1 = (c1 - c2) / BigInteger(2);
+  c2 -= c0;
+  c3 = (c2 - c3) / BigInteger(2) + c4 + c4;
+  c2 += c1 - c4;
+  c1 -= c3;
+
+  // Recomposition, all the coefficients are non-negative.
+  size_t n = an + bn;
+  std::fill(r, r + n, 0u);
+  const BigInteger* c[] = { &c0, &c1, &c2, &c3, &c4 };
+  for (size_t i = 0; i < 5; ++i)
+  {
+    const value_type& limbs = c[i]->limbs_;
+    limb_add(r + i * k, r + i * k, n - i * k, limbs.data(), limbs.size());
+  }
+}
+
+// q = |a| / |b|, r = |a| % |b|, the divisor can not be zero.
+void BigInteger::_divide(const BigInteger& a, const BigInteger& b,
+                         BigInteger& q, BigInteger& r)
+{
+  if (a.limbs_.size() <= 2 && b.limbs_.size() <= 2)
+  {
+    uint64_t x = a._small();
+    uint64_t y = b._small();
+    q._set_small(x / y);
+    r._set_small(x % y);
+    return;
   }
-  for (; i < addend._group_size(); ++i)
+  if (b.limbs_.size() < BZ_THRESHOLD ||
+      a.limbs_.size() < b.limbs_.size() + BZ_THRESHOLD / 2)
   {
-    int16_t sum = addend._group(i) + carry;
-    _group_push(MOD(sum));
-    carry = DIV(sum);
+    _divide_knuth(a, b, q, r);
   }
-  if (carry)
+  else
   {
-    _group_push(carry);
+    _divide_bz(a, b, q, r);
   }
-  return *this;
 }
 
-BigInteger& BigInteger::_minus_with_pos(const BigInteger& subtrahend)
+void BigInteger::_divide_knuth(const BigInteger& a, const BigInteger& b,
+                               BigInteger& q, BigInteger& r)
 {
-  if (subtrahend.is_zero())
+  size_t an = a.limbs_.size();
+  size_t bn = b.limbs_.size();
+  if (a._compare(b) < 0)
   {
-    return *this;
+    r = a.absolute();
+    q = BigInteger(0);
+    return;
   }
-  if (is_zero())
+  BigInteger quotient(0);
+  BigInteger remainder(0);
+  quotient.limbs_.resize(an - bn + 1);
+  if (bn == 1)
   {
-    *this = subtrahend.opposite();
-    return *this;
+    uint32_t rem = limb_div_1(quotient.limbs_.data(), a.limbs_.data(),
+                              an, b.limbs_[0]);
+    remainder.limbs_.assign(1, rem);
+  }
+  else
+  {
+    remainder.limbs_.resize(bn);
+    limb_divmod(quotient.limbs_.data(), remainder.limbs_.data(),
+                a.limbs_.data(), an, b.limbs_.data(), bn);
+  }
+  quotient._trim();
+  remainder._trim();
+  q = std::move(quotient);
+  r = std::move(remainder);
+}
+
+// Burnikel-Ziegler recursive division. The divisor is padded and shifted to
+// n limbs with the highest bit set, where n is a power of two multiple of a
+// block less than BZ_THRESHOLD limbs. Then the dividend is divided by n
+// limbs each time from the high end, by _divide_2n1n.
+void BigInteger::_divide_bz(const BigInteger& a, const BigInteger& b,
+                            BigInteger& q, BigInteger& r)
+{
+  size_t bn = b.limbs_.size();
+  size_t m = 1;
+  while (m * BZ_THRESHOLD <= bn)
+  {
+    m <<= 1;
+  }
+  size_t n = (bn + m - 1) / m * m;
+  size_t shift = (n - bn) * LIMB_BITS + LIMB_BITS - limb_bits(b.limbs_.back());
+  BigInteger bb = b.absolute();
+  BigInteger aa = a.absolute();
+  bb._shift_left(shift);
+  aa._shift_left(shift);
+
+  // The highest block must be less than the divisor, so leaves at least one
+  // zero bit on the top.
+  size_t t = std::max<size_t>(2, (aa._bit_length() + 1 + n * LIMB_BITS - 1)
+                                 / (n * LIMB_BITS));
+  const uint32_t* p = aa.limbs_.data();
+  size_t pn = aa.limbs_.size();
+  auto block = [&](size_t i) {
+    size_t lo = std::min(i * n, pn);
+    return _from_limbs(p + lo, std::min(n, pn - lo));
+  };
+  BigInteger z = block(t - 1);
+  z._shift_left(n * LIMB_BITS);
+  z += block(t - 2);
+  BigInteger quotient(0);
+  quotient._grow((t - 1) * n);
+  BigInteger qi(0);
+  BigInteger ri(0);
+  for (size_t i = t - 1; i-- > 0; )
+  {
+    _divide_2n1n(z, bb, n, qi, ri);
+    std::copy(qi.limbs_.begin(), qi.limbs_.end(),
+              quotient.limbs_.begin() + i * n);
+    if (i > 0)
+    {
+      z = std::move(ri);
+      z._shift_left(n * LIMB_BITS);
+      z += block(i - 1);
+    }
   }
+  quotient._trim();
+  ri._shift_right(shift);
+  q = std::move(quotient);
+  r = std::move(ri);
+}
 
-  // The larger one minus the smaller one.
-  BigInteger larger(*this);
-  BigInteger smaller(subtrahend);
-  int16_t cmp = larger.compare(smaller);
-  if (cmp == 0)
+// Divides a by b of n limbs with the highest bit set, a < b * 2^(32 * n).
+void BigInteger::_divide_2n1n(const BigInteger& a, const BigInteger& b,
+                              size_t n, BigInteger& q, BigInteger& r)
+{
+  if ((n & 1) != 0 || n < BZ_THRESHOLD)
   {
-    *this = BigInteger(0);
-    return *this;
+    _divide_knuth(a, b, q, r);
+    return;
+  }
+  // Let a = [a1, a2, a3, a4] by n / 2 limbs, divides [a1, a2, a3] by b,
+  // then divides [r1, a4] by b.
+  size_t h = n / 2;
+  BigInteger high = a;
+  high._shift_right(h * LIMB_BITS);
+  BigInteger q1(0);
+  BigInteger r1(0);
+  _divide_3n2n(high, b, h, q1, r1);
+  r1._shift_left(h * LIMB_BITS);
+  r1 += _from_limbs(a.limbs_.data(), std::min(h, a.limbs_.size()));
+  _divide_3n2n(r1, b, h, q, r);
+  q1._shift_left(h * LIMB_BITS);
+  q += q1;
+}
+
+// Divides a by b of 2n limbs with the highest bit set, a < b * 2^(32 * n).
+void BigInteger::_divide_3n2n(const BigInteger& a, const BigInteger& b,
+                              size_t n, BigInteger& q, BigInteger& r)
+{
+  // Let a = [a1, a2, a3], b = [b1, b2] by n limbs, estimates the quotient
+  // by [a1, a2] / b1, which is at most two greater than the real one.
+  size_t bits = n * LIMB_BITS;
+  BigInteger a12 = a;
+  a12._shift_right(bits);
+  BigInteger a1 = a12;
+  a1._shift_right(bits);
+  BigInteger b1 = b;
+  b1._shift_right(bits);
+  BigInteger b2 = _from_limbs(b.limbs_.data(), n);
+  BigInteger r1(0);
+  if (a1._compare(b1) < 0)
+  {
+    _divide_2n1n(a12, b1, n, q, r1);
+  }
+  else
+  {
+    // q = 2^(32 * n) - 1, r1 = [a1, a2] - q * b1 = [a1, a2] - [b1, 0] + b1
+    q = BigInteger(1);
+    q._shift_left(bits);
+    --q;
+    BigInteger t = b1;
+    t._shift_left(bits);
+    r1 = a12 - t + b1;
   }
-  bool neg_symbol = false;
-  if (cmp < 0)
+  r1._shift_left(bits);
+  r1 += _from_limbs(a.limbs_.data(), std::min(n, a.limbs_.size()));
+  r1 -= q * b2;
+  while (r1.is_negative())
   {
-    larger.swap(smaller);
-    neg_symbol = true;
+    --q;
+    r1 += b;
   }
+  r = std::move(r1);
+}
 
-  int16_t borrow = 0;
-  size_t i = 0;
-  for (; i < smaller._group_size(); ++i)
+// Reduces a and b to gcd(a, b) and zero in a, where a and b are not
+// negative. If s is not null, s[0] and s[1] are the cofactors of a and b,
+// which have the same linear transformation as a and b.
+void BigInteger::_gcd(BigInteger& a, BigInteger& b, BigInteger* s)
+{
+  const size_t cols = s == nullptr ? 0 : 1;
+  if (a._compare(b) < 0)
   {
-    int16_t diff = larger._group(i) - smaller._group(i) - borrow;
-    if (diff < 0)
-    {
-      diff += 10000;
-      borrow = 1;
-    }
-    else
+    a.swap(b);
+    if (s != nullptr)
     {
-      borrow = 0;
+      s[0].swap(s[1]);
     }
-    larger._group_adjust(i, diff);
   }
-  for (; i < larger._group_size(); ++i)
+  while (!b.is_zero())
   {
-    int16_t diff = larger._group(i) - borrow;
-    if (diff < 0)
+    const size_t n = a.limbs_.size();
+    if (n <= 2 && s == nullptr)
     {
-      diff += 10000;
-      borrow = 1;
+      a._set_small(word_gcd(a._small(), b._small()));
+      b = BigInteger(0);
     }
-    else
+    else if (n <= 2 || b.limbs_.size() + 1 < n)
     {
-      borrow = 0;
+      _gcd_divide(a, b, s, cols);
     }
-    larger._group_adjust(i, diff);
-  }
-  larger._clear_excess_zeros();
-  if (neg_symbol)
-  {
-    larger._symbol_neg();
-  }
-  *this = std::move(larger);
-  return *this;
-}
-
-BigInteger& BigInteger::_multiply_with_pos(const BigInteger& m)
-{
-  // The product of n-digits number multiplied by m-digits number
-  // has at least (n + m - 1) digits.
-  REDBUD_THROW_EX_IF(static_cast<int64_t>(digits()) +
-                     static_cast<int64_t>(m.digits()) - 1 > MAX_DIGITS,
-                     "Overflow.");
-  // The group of result is less than or equal to the sum of two multiplier.
-  BigInteger result(0);
-  result.number_.assign(_group_size() + m._group_size(), 0);
-
-  size_t i = 0;
-  size_t j = 0;
-  for (; j < m._group_size(); ++j)
-  {
-    int32_t carry = 0;
-    for (i = 0; i < _group_size(); ++i)
+    else if (n >= HGCD_THRESHOLD)
     {
-      int32_t p = static_cast<int32_t>(m._group(j))
-        * static_cast<int32_t>(_group(i)) + carry;
-      carry = result._add_and_carry(j + i, MOD(p)) ? DIV(p) + 1 : DIV(p);
+      BigInteger w[4] = { BigInteger(1), BigInteger(0),
+                          BigInteger(0), BigInteger(1) };
+      _half_gcd(a, b, w);
+      if (s != nullptr)
+      {
+        _gcd_rows(w, s, 1);
+      }
+      if (a.limbs_.size() >= n && !b.is_zero())
+      {
+        _gcd_divide(a, b, s, cols);
+      }
     }
-    if (carry != 0)
-    { // The carry must be less than 10000.
-      result._add_and_carry(j + i, carry);
+    else if (!_gcd_lehmer(a, b, s, cols))
+    {
+      _gcd_divide(a, b, s, cols);
     }
   }
-  result._clear_excess_zeros();
-  *this = std::move(result);
-  return *this;
 }
 
-BigInteger& BigInteger::_divide_with_pos(const BigInteger& divisor)
+// Reduces a and b (a >= b) to about the half of the limbs of a, where the
+// top half of the limbs decides the quotients of Euclid's algorithm. The
+// transformation is multiplied to the left of the matrix w.
+//
+// The matrices of the top half are computed recursively and applied to the
+// full numbers, the quotients may be a little wrong near the end, but any
+// unimodular transformation keeps the GCD, and a negative result is negated.
+void BigInteger::_half_gcd(BigInteger& a, BigInteger& b, BigInteger* w)
 {
-  size_t g1 = _group_size();
-  size_t g2 = divisor._group_size();
-  BigInteger dividend(0);
-  BigInteger multiple(0);
-  BigInteger result(0);
-  result.number_.assign(g1, 0);
-
-  // Each time take the same group as divisor's as new dividend,
-  // if dividend is less than divisor, takes a more group.
-  // Then finds their quotient as the result in the corresponding
-  // group of the result, and minus the corresponding multiple.
-  // Repeats this process until the number of their group is equal. 
-  for (; g1 >= g2; g1 = _group_size())
-  {
-    dividend = _high_range(g2);
-    int16_t cmp = dividend.compare(divisor);
-    if (g1 == g2)
+  const size_t n = a.limbs_.size();
+  const size_t s = n / 2 + 1;
+  if (n < HGCD_BASE)
+  {
+    while (b.limbs_.size() > s)
     {
-      if (cmp < 0)
+      if (!_gcd_lehmer(a, b, w, 2))
       {
-        result._clear_excess_zeros();
-        *this = std::move(result);
-        return *this;
-      }
-      if (cmp == 0)
-      {
-        result._group_adjust(g1 - 1, 1);
-        result._clear_excess_zeros();
-        *this = std::move(result);
-        return *this;
+        _gcd_divide(a, b, w, 2);
       }
     }
-    size_t borrow = cmp < 0 ? 1 : 0;
-    dividend = _high_range(g2 + borrow);
-    int32_t quotient = _search(dividend, divisor);
-    multiple = (divisor * BigInteger(quotient));
-    multiple._shift10((g1 - g2 - borrow) << 2, kMoveLeft);
-    result._group_adjust(g1 - g2 - borrow, quotient);
-    *this -= multiple;
-  }
-  result._clear_excess_zeros();
-  *this = std::move(result);
-  return *this;
-}
+    return;
+  }
 
-BigInteger BigInteger::_power_of(const BigInteger& n) const
-{
-  REDBUD_THROW_EX_IF(is_zero() && !n.is_positive(), "Invalid value.");
-  if (is_zero() || (_group(0) != 1 && n.is_negative()))
+  // Reduces the top half to a quarter, so a and b have about 3n/4 limbs.
+  BigInteger m[4] = { BigInteger(1), BigInteger(0),
+                      BigInteger(0), BigInteger(1) };
+  BigInteger x(a);
+  BigInteger y(b);
+  x._shift_right(n / 2 * LIMB_BITS);
+  y._shift_right(n / 2 * LIMB_BITS);
+  _half_gcd(x, y, m);
+  _gcd_apply(a, b, m, w, 2);
+  if (b.limbs_.size() <= s)
   {
-    return BigInteger(0);
-  }
-  if (n.is_zero() ||                            
-     (number_.size() == 1 && number_[0] == POSITIVE1) ||
-     (number_.size() == 1 && number_[0] == NEGATIVE1 && n.is_even()))
-  { // x^0, x != 0 || 1^n || (-1)^n, n is even
-    return BigInteger(1);
-  }
-  if (number_.size() == 1 && number_[0] == NEGATIVE1 && n.is_odd()) 
-  { // (-1)^n, n is odd
-    return BigInteger(-1);
+    return;
   }
-  if (n.number_.size() == 1 && n.number_[0] == POSITIVE1)             
-  { // x^1
-    return BigInteger(*this);
+  _gcd_divide(a, b, w, 2);
+  if (b.limbs_.size() <= s)
+  {
+    return;
   }
 
-  // If this BigInteger is power of ten, just shift to get the result.
-  int64_t p = absolute()._is_pow10();
-  if (p >= 0)
-  {
-    auto pair = n.to_integer<uint32_t>();
-    REDBUD_THROW_EX_IF(pair.second == false, "Overflow.");
-    int64_t shift = p * static_cast<int64_t>(pair.first);
-    REDBUD_THROW_EX_IF(shift >= MAX_DIGITS, "Overflow.");
-    BigInteger result(1);
-    result._shift10(static_cast<size_t>(shift), kMoveLeft);
-    if (is_negative() && n.is_odd())
+  // Reduces the top 2(k - s) limbs to the half, so b has about s limbs.
+  const size_t k = a.limbs_.size();
+  const size_t p = 2 * s > k ? 2 * s - k : 0;
+  m[0] = BigInteger(1);
+  m[1] = BigInteger(0);
+  m[2] = BigInteger(0);
+  m[3] = BigInteger(1);
+  x = a;
+  y = b;
+  x._shift_right(p * LIMB_BITS);
+  y._shift_right(p * LIMB_BITS);
+  _half_gcd(x, y, m);
+  _gcd_apply(a, b, m, w, 2);
+}
+
+// One step of Euclid's algorithm, (a, b) = (b, a - q * b), q = a / b.
+void BigInteger::_gcd_divide(BigInteger& a, BigInteger& b,
+                             BigInteger* w, size_t cols)
+{
+  BigInteger q(0);
+  BigInteger r(0);
+  _divide(a, b, q, r);
+  a.swap(b);
+  b.swap(r);
+  for (size_t j = 0; j < cols; ++j)
+  {
+    w[j].swap(w[cols + j]);
+    w[cols + j].submul(q, w[j]);
+  }
+}
+
+// Lehmer's algorithm, the quotients of Euclid's algorithm are computed by
+// the leading 61 bits as long as they are the same for the bounds of the
+// numbers (Knuth's algorithm L), then the steps are applied by a matrix of
+// words. Returns false if no quotient is known.
+bool BigInteger::_gcd_lehmer(BigInteger& a, BigInteger& b,
+                             BigInteger* w, size_t cols)
+{
+  const size_t bits = a._bit_length();
+  const size_t h = bits > 61 ? bits - 61 : 0;
+  int64_t x = static_cast<int64_t>(
+    limb_extract(a.limbs_.data(), a.limbs_.size(), h));
+  int64_t y = static_cast<int64_t>(
+    limb_extract(b.limbs_.data(), b.limbs_.size(), h));
+  int64_t ma = 1, mb = 0, mc = 0, md = 1;
+  while (y != 0 && y + mc != 0 && y + md != 0)
+  {
+    int64_t q = (x + ma) / (y + mc);
+    if (q != (x + mb) / (y + md))
     {
-      result._symbol_neg();
+      break;
     }
-    return result;
-  }
-
-  int64_t d1 = digits() - 1;
-  auto pair = n.to_integer<uint32_t>();
-  REDBUD_THROW_EX_IF(pair.second == false, "Overflow.");
-  int64_t shift = d1 * static_cast<int64_t>(pair.first);
-  REDBUD_THROW_EX_IF(shift >= MAX_DIGITS, "Overflow.");
-  BigInteger result(*this);
-  if (n.is_odd())
-  {
-    result = result.power(n / 2) * result.power(n / 2) * result;
-  }
-  else
+    int64_t t = ma - q * mc;
+    ma = mc;
+    mc = t;
+    t = mb - q * md;
+    mb = md;
+    md = t;
+    t = x - q * y;
+    x = y;
+    y = t;
+  }
+  if (mb == 0)
   {
-    result = result.power(n / 2) * result.power(n / 2);
+    return false;
   }
-  return result;
+  const BigInteger m[4] = { BigInteger(ma), BigInteger(mb),
+                            BigInteger(mc), BigInteger(md) };
+  _gcd_apply(a, b, m, w, cols);
+  return true;
 }
 
-// Shift int the decimal system(base 10).
-void BigInteger::_shift10(size_t n, ShiftType direction)
+// (a, b) = m * (a, b), and the rows of w are transformed in the same way.
+// The results are made positive and a >= b by negating or swapping the
+// rows.
+void BigInteger::_gcd_apply(BigInteger& a, BigInteger& b,
+                            const BigInteger* m, BigInteger* w, size_t cols)
 {
-  if (is_zero())
-  {
-    return;
-  }
-  if (direction == kMoveLeft)
+  BigInteger x = m[0] * a;
+  x.addmul(m[1], b);
+  BigInteger y = m[2] * a;
+  y.addmul(m[3], b);
+  _gcd_rows(m, w, cols);
+  if (x.is_negative())
   {
-    REDBUD_THROW_EX_IF(static_cast<int64_t>(digits()) +
-                       static_cast<int64_t>(n) > MAX_DIGITS, "Overflow.");
-    if ((n & 3) == 0)
-    {  // Multiple of 4
-      number_.insert(number_.begin(), n >> 2, 0);
-      return;
+    x.reverse();
+    for (size_t j = 0; j < cols; ++j)
+    {
+      w[j].reverse();
     }
-    std::string num = to_string();
-    num.append(n, '0');
-    *this = num.data();
   }
-  else // Moveright.
+  if (y.is_negative())
   {
-    if (n >= digits())
-    {
-      number_.clear();
-    }
-    else
+    y.reverse();
+    for (size_t j = 0; j < cols; ++j)
     {
-      if ((n & 3) == 0)
-      {  // Multiple of 4
-        number_.erase(number_.begin(), number_.begin() + (n >> 2));
-        return;
-      }
-      std::string num = to_string();
-      num.erase(num.end() - n, num.end());
-      *this = num.data();
+      w[cols + j].reverse();
     }
   }
-}
-
-// Returns a BigInteger which is former n group of this BigInteger.
-// e.g. If there is a BigInteger b("123456789999"), b._high_range(1) will 
-// get BigInteger("1234"), b._high_range(2) will get BigInteger("12345678").
-BigInteger BigInteger::_high_range(size_t n) const
-{
-  size_t g = _group_size();
-  BigInteger result(0);
-  for (size_t i = 1; i <= n; ++i)
+  if (x._compare(y) < 0)
   {
-    BigInteger g_num(_group(g - i));
-    g_num._shift10((n - i) << 2, kMoveLeft);
-    result += g_num;
+    x.swap(y);
+    for (size_t j = 0; j < cols; ++j)
+    {
+      w[j].swap(w[cols + j]);
+    }
   }
-  return result;
+  a.swap(x);
+  b.swap(y);
 }
 
-// Finds the quotient of dividend and divisor by binary search.
-int16_t BigInteger::
-_search(const BigInteger& dividend, const BigInteger& divisor) const
+// Multiplies the matrix m to the left of w, which has two rows of cols.
+void BigInteger::_gcd_rows(const BigInteger* m, BigInteger* w, size_t cols)
 {
-  // The range of quotient is [1, 9999]
-  int16_t low = 1;
-  int16_t high = 9999;
-  while (low < high)
+  for (size_t j = 0; j < cols; ++j)
   {
-    int16_t half = (low + high) >> 1;
-    if (low + 1 == high)
-    {
-      return dividend.compare(divisor * BigInteger(high)) < 0 ? low : high;
-    }
-    if (dividend.compare(divisor * BigInteger(half)) < 0)
-    {
-      high = half - 1;
-    }
-    else
-    {
-      low = half;
-    }
+    BigInteger u = m[0] * w[j];
+    u.addmul(m[1], w[cols + j]);
+    BigInteger v = m[2] * w[j];
+    v.addmul(m[3], w[cols + j]);
+    w[j].swap(u);
+    w[cols + j].swap(v);
   }
-  return low;
 }
 
 // ============================================================================
@@ -1050,6 +2637,11 @@ BigInteger operator-(const BigInteger& lhs, const BigInteger& rhs)
 
 BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs)
 {
+  // The product is built in a new storage, so copies the shorter one.
+  if (lhs.limbs_.size() > rhs.limbs_.size())
+  {
+    return rhs * lhs;
+  }
   BigInteger result(lhs);
   result *= rhs;
   return result;
@@ -1057,16 +2649,93 @@ BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs)
 
 BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs)
 {
-  BigInteger result(lhs);
-  result /= rhs;
-  return result;
+  return BigInteger::divmod(lhs, rhs).first;
 }
 
 BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs)
 {
-  BigInteger result(lhs);
-  result %= rhs;
-  return result;
+  REDBUD_THROW_EX_IF(rhs.is_zero(), "The modulus can not be zero.");
+  return BigInteger::divmod(lhs, rhs).second;
+}
+
+BigInteger operator+(BigInteger&& lhs, const BigInteger& rhs)
+{
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator+(const BigInteger& lhs, BigInteger&& rhs)
+{
+  rhs += lhs;
+  return std::move(rhs);
+}
+
+BigInteger operator+(BigInteger&& lhs, BigInteger&& rhs)
+{
+  // Reuses the longer one, which has the storage for the sum.
+  if (lhs.limbs_.size() < rhs.limbs_.size())
+  {
+    rhs += lhs;
+    return std::move(rhs);
+  }
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator-(BigInteger&& lhs, const BigInteger& rhs)
+{
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator-(const BigInteger& lhs, BigInteger&& rhs)
+{
+  // x - y = -(y - x)
+  rhs -= lhs;
+  rhs.reverse();
+  return std::move(rhs);
+}
+
+BigInteger operator-(BigInteger&& lhs, BigInteger&& rhs)
+{
+  if (lhs.limbs_.size() < rhs.limbs_.size())
+  {
+    rhs -= lhs;
+    rhs.reverse();
+    return std::move(rhs);
+  }
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator*(BigInteger&& lhs, const BigInteger& rhs)
+{
+  lhs *= rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator*(const BigInteger& lhs, BigInteger&& rhs)
+{
+  rhs *= lhs;
+  return std::move(rhs);
+}
+
+BigInteger operator*(BigInteger&& lhs, BigInteger&& rhs)
+{
+  lhs *= rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator/(BigInteger&& lhs, const BigInteger& rhs)
+{
+  lhs /= rhs;
+  return std::move(lhs);
+}
+
+BigInteger operator%(BigInteger&& lhs, const BigInteger& rhs)
+{
+  lhs %= rhs;
+  return std::move(lhs);
 }
 
 BigInteger operator<<(const BigInteger& lhs, const BigInteger& rhs)
@@ -1083,12 +2752,33 @@ BigInteger operator >> (const BigInteger& lhs, const BigInteger& rhs)
   return result;
 }
 
+BigInteger operator&(const BigInteger& lhs, const BigInteger& rhs)
+{
+  BigInteger result(lhs);
+  result &= rhs;
+  return result;
+}
+
+BigInteger operator|(const BigInteger& lhs, const BigInteger& rhs)
+{
+  BigInteger result(lhs);
+  result |= rhs;
+  return result;
+}
+
+BigInteger operator^(const BigInteger& lhs, const BigInteger& rhs)
+{
+  BigInteger result(lhs);
+  result ^= rhs;
+  return result;
+}
+
 // ============================================================================
 // Overloads comparison opeaators.
 
 bool operator==(const BigInteger& lhs, const BigInteger& rhs)
 {
-  return lhs.number_ == rhs.number_;
+  return lhs.sign_ == rhs.sign_ && lhs.limbs_ == rhs.limbs_;
 }
 
 bool operator!=(const BigInteger& lhs, const BigInteger& rhs)
@@ -1123,31 +2813,237 @@ std::istream& operator >> (std::istream& is, BigInteger& b)
 {
   std::string buf;
   is >> buf;
-  b.number_.clear();
-  b._string_init(buf.data());
+  b._string_init(buf.data(), buf.size());
   return is;
 }
 
 std::ostream& operator<<(std::ostream& os, const BigInteger& b)
 {
-  b.print();
-  return os;
+  return os << b.to_string();
+}
+
+// ============================================================================
+// ModContext
+
+ModContext::ModContext(const BigInteger& m)
+  :modulus_(m), mu_(1), r2_(0), one_(1), minv_(0), montgomery_(false)
+{
+  REDBUD_THROW_EX_IF(!m.is_positive(), "The modulus must be positive.");
+  const size_t n = m.limbs_.size();
+  // mu = floor(2^(64n) / m).
+  mu_._shift_left(2 * n * LIMB_BITS);
+  mu_ /= m;
+  montgomery_ = (m.limbs_[0] & 1) != 0 && n < MONTGOMERY_THRESHOLD;
+  if (montgomery_)
+  {
+    // m * x = 1 mod 2^k implies m * x * (2 - m * x) = 1 mod 2^(2k), and
+    // x = m is right for k = 3.
+    uint32_t x = m.limbs_[0];
+    for (int i = 0; i < 4; ++i)
+    {
+      x *= 2 - m.limbs_[0] * x;
+    }
+    minv_ = 0u - x;
+    r2_._set_small(1);
+    r2_._shift_left(2 * n * LIMB_BITS);
+    r2_ = _barrett(std::move(r2_));
+    one_ = _redc(BigInteger(r2_));
+  }
+  else
+  {
+    one_ = reduce(one_);
+  }
+}
+
+const BigInteger& ModContext::modulus() const
+{
+  return modulus_;
+}
+
+BigInteger ModContext::reduce(const BigInteger& x) const
+{
+  BigInteger r = x.absolute();
+  if (r._compare(modulus_) >= 0)
+  {
+    r = r.limbs_.size() <= 2 * modulus_.limbs_.size()
+      ? _barrett(std::move(r)) : r % modulus_;
+  }
+  if (x.is_negative() && !r.is_zero())
+  {
+    r = modulus_ - r;
+  }
+  return r;
+}
+
+BigInteger ModContext::to_form(const BigInteger& x) const
+{
+  BigInteger r = reduce(x);
+  return montgomery_ ? _redc(r * r2_) : r;
+}
+
+BigInteger ModContext::from_form(const BigInteger& x) const
+{
+  return montgomery_ ? _redc(BigInteger(x)) : x;
+}
+
+BigInteger ModContext::mul(const BigInteger& a, const BigInteger& b) const
+{
+  return _reduce(a * b);
+}
+
+BigInteger ModContext::sqr(const BigInteger& a) const
+{
+  return _reduce(a.square());
+}
+
+BigInteger ModContext::mulmod(const BigInteger& a, const BigInteger& b) const
+{
+  return _barrett(reduce(a) * reduce(b));
+}
+
+BigInteger ModContext::powmod(const BigInteger& a, const BigInteger& e) const
+{
+  BigInteger x = to_form(e.is_negative() ? invmod(a) : a);
+  const BigInteger n = e.absolute();
+  const size_t ebits = n.bit_length();
+  if (ebits == 0)
+  {
+    return from_form(one_);
+  }
+
+  // Left-to-right sliding window exponentiation like BigInteger::power.
+  size_t k = ebits > 671 ? 6 : ebits > 239 ? 5 : ebits > 79 ? 4
+    : ebits > 23 ? 3 : ebits > 6 ? 2 : 1;
+  std::vector<BigInteger> odd(1, x);
+  if (k > 1)
+  {
+    BigInteger x2 = sqr(x);
+    for (size_t i = 1; i < (size_t(1) << (k - 1)); ++i)
+    {
+      odd.push_back(mul(odd.back(), x2));
+    }
+  }
+  BigInteger result(one_);
+  bool first = true;
+  for (size_t i = ebits; i-- > 0; )
+  {
+    if (!n.test_bit(i))
+    {
+      result = sqr(result);
+      continue;
+    }
+    size_t j = i + 1 < k ? 0 : i + 1 - k;
+    for (; !n.test_bit(j); ++j)
+      ; // Empty loop body.
+    size_t window = 0;
+    for (size_t l = i + 1; l-- > j; )
+    {
+      window = (window << 1) | (n.test_bit(l) ? 1 : 0);
+    }
+    if (first)
+    {
+      result = odd[window >> 1];
+      first = false;
+    }
+    else
+    {
+      for (size_t l = j; l <= i; ++l)
+      {
+        result = sqr(result);
+      }
+      result = mul(result, odd[window >> 1]);
+    }
+    i = j;
+  }
+  return from_form(result);
+}
+
+BigInteger ModContext::invmod(const BigInteger& a) const
+{
+  return BigInteger::mod_inverse(a, modulus_);
+}
+
+// Montgomery reduction, returns t / R mod m for t in [0, m * R).
+BigInteger ModContext::_redc(BigInteger&& t) const
+{
+  const size_t n = modulus_.limbs_.size();
+  const uint32_t* m = modulus_.limbs_.data();
+  t._grow(2 * n + 1);
+  uint32_t* p = t.limbs_.data();
+  for (size_t i = 0; i < n; ++i)
+  {
+    // Adds u * m to make the ith limb zero.
+    uint32_t u = p[i] * minv_;
+    uint64_t c = limb_addmul_1(p + i, m, n, u);
+    for (size_t j = i + n; c != 0; ++j)
+    {
+      c += p[j];
+      p[j] = static_cast<uint32_t>(c);
+      c >>= LIMB_BITS;
+    }
+  }
+  std::copy(p + n, p + 2 * n + 1, p);
+  t.limbs_.resize(n + 1);
+  t._trim();
+  if (t._compare(modulus_) >= 0)
+  {
+    t._minus_with_pos(modulus_);
+  }
+  return std::move(t);
+}
+
+// Barrett reduction, returns t mod m for t in [0, 2^(64n)).
+BigInteger ModContext::_barrett(BigInteger&& t) const
+{
+  const size_t n = modulus_.limbs_.size();
+  if (t._compare(modulus_) < 0)
+  {
+    return std::move(t);
+  }
+  BigInteger q(t);
+  q._shift_right((n - 1) * LIMB_BITS);
+  q *= mu_;
+  q._shift_right((n + 1) * LIMB_BITS);
+  // The estimated quotient is less than the exact one by at most two.
+  t._minus_with_pos(q * modulus_);
+  while (t._compare(modulus_) >= 0)
+  {
+    t._minus_with_pos(modulus_);
+  }
+  return std::move(t);
+}
+
+// Reduces a product of two values in the form of the context.
+BigInteger ModContext::_reduce(BigInteger&& t) const
+{
+  return montgomery_ ? _redc(std::move(t)) : _barrett(std::move(t));
 }
 
 // ============================================================================
 // Cancels macro definition.
 
-#undef POS_PORT
-#undef NEG_PORT
-#undef BITNUM
-#undef GROUP_NUM
-#undef MOD
-#undef DIV
-#undef MUL
-#undef POSITIVE1
-#undef NEGATIVE1
-#undef MAX_GROUPS
+#undef LIMB_BITS
+#undef LIMB_MAX
+#undef DEC_BASE
+#undef DEC_DIGITS
+#undef MAX_LIMBS
 #undef MAX_DIGITS
+#undef KARATSUBA_THRESHOLD
+#undef TOOM3_THRESHOLD
+#undef NTT_THRESHOLD
+#undef NTT_MAX_SIZE
+#undef BZ_THRESHOLD
+#undef TO_STRING_THRESHOLD
+#undef FROM_STRING_THRESHOLD
+#undef MONTGOMERY_THRESHOLD
+#undef HGCD_THRESHOLD
+#undef HGCD_BASE
+#undef NTT_P1
+#undef NTT_G1
+#undef NTT_P2
+#undef NTT_G2
+#undef NTT_P3
+#undef NTT_G3
 
 #if defined(REDBUD_MSVC)
   #pragma warning(pop)
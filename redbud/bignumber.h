@@ -10,11 +10,14 @@
 #ifndef ALINSHANS_REDBUD_BIGNUMBER_H_
 #define ALINSHANS_REDBUD_BIGNUMBER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <vector>      // vector 
 #include <iosfwd>      // istream, ostream, printf
 #include <string>      // string
+#include <string_view> // string_view
+#include <tuple>       // tuple
 #include <utility>     // move
 #include <limits>      // numeric_limits
 
@@ -50,6 +53,13 @@ typedef enum kShift
   kMoveLeft  = 1
 }ShiftType;
 
+typedef enum kBitwise
+{
+  kAnd = 0,
+  kOr  = 1,
+  kXor = 2
+}BitwiseType;
+
 typedef enum kNumber
 {
   kZero               = 0,
@@ -57,13 +67,126 @@ typedef enum kNumber
   kScientificNotation = 2
 }NumberType;
 
+// ============================================================================
+// LimbVector class
+//
+// LimbVector is the storage of BigInteger, a vector of 32-bit limbs which
+// keeps at most four limbs (two 64-bit words) in place, and only allocates
+// from the heap for the larger ones. So the small BigIntegers, like most of
+// the temporaries, never allocate. The new limbs are always zero.
+class LimbVector
+{
+
+ public:
+
+  typedef uint32_t        value_type;
+  typedef uint32_t*       iterator;
+  typedef const uint32_t* const_iterator;
+  typedef size_t          size_type;
+
+ public:
+
+  LimbVector() noexcept
+    :size_(0), capacity_(kInlineLimbs)
+  {
+  }
+
+  explicit LimbVector(size_t n)
+    :LimbVector()
+  {
+    resize(n);
+  }
+
+  LimbVector(const LimbVector& other)
+    :LimbVector()
+  {
+    assign(other.begin(), other.end());
+  }
+
+  LimbVector(LimbVector&& other) noexcept
+    :LimbVector()
+  {
+    _steal(other);
+  }
+
+  ~LimbVector()
+  {
+    _free();
+  }
+
+  LimbVector& operator=(const LimbVector& other)
+  {
+    if (this != &other)
+    {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  LimbVector& operator=(LimbVector&& other) noexcept
+  {
+    if (this != &other)
+    {
+      _free();
+      _steal(other);
+    }
+    return *this;
+  }
+
+ public:
+
+  size_t          size()  const noexcept { return size_; }
+  bool            empty() const noexcept { return size_ == 0; }
+  uint32_t*       data()        noexcept { return _inline() ? small_ : heap_; }
+  const uint32_t* data()  const noexcept { return _inline() ? small_ : heap_; }
+
+  iterator        begin()       noexcept { return data(); }
+  iterator        end()         noexcept { return data() + size_; }
+  const_iterator  begin() const noexcept { return data(); }
+  const_iterator  end()   const noexcept { return data() + size_; }
+
+  uint32_t&       operator[](size_t n)       { return data()[n]; }
+  const uint32_t& operator[](size_t n) const { return data()[n]; }
+  uint32_t&       back()                     { return data()[size_ - 1]; }
+  const uint32_t& back()               const { return data()[size_ - 1]; }
+
+  void clear() noexcept { size_ = 0; }
+  void reserve(size_t n);
+  void resize(size_t n);
+  void push_back(uint32_t value);
+  void assign(size_t n, uint32_t value);
+  void assign(const uint32_t* first, const uint32_t* last);
+  void swap(LimbVector& other) noexcept;
+
+  friend bool operator==(const LimbVector& lhs, const LimbVector& rhs);
+
+ private:
+
+  static constexpr uint32_t kInlineLimbs = 4;
+
+  // The capacity of the heap storage is always greater than kInlineLimbs.
+  bool _inline() const noexcept { return capacity_ == kInlineLimbs; }
+  void _free() noexcept;
+  void _steal(LimbVector& other) noexcept;
+
+ private:
+
+  uint32_t size_;
+  uint32_t capacity_;
+  union
+  {
+    uint32_t* heap_;
+    uint32_t  small_[kInlineLimbs];
+  };
+};
+
 // ============================================================================
 // BigInteger class
 //
 // BigInteger Provides convenient operations for large integer, the BigInteger
-// can be expressed in the range (-10^4294967292, 10^4294967292). These
-// operations are not very efficient, so the BigInteger should not be used
-// when the requirements are more stringent.
+// can be expressed in the range (-2^14267572512, 2^14267572512), which is
+// about (-10^4294967292, 10^4294967292). The number is stored in binary, so
+// the decimal conversion only happens on input and output.
 //
 // The default constructor is not provided, so it must be explicitly
 // constructed like:
@@ -82,7 +205,7 @@ typedef enum kNumber
 // bit operations, comparison operations with build-in integer type
 // and BigInteger like:
 //   +, -, *, /, %, +=, -=, *=, /=, %=, ++, --, <<, >>, <<=, >>=, 
-//   ==, !=, <, >, <= ,>=, and standard I/O streams.
+//   &, |, ^, ~, &=, |=, ^=, ==, !=, <, >, <= ,>=, and standard I/O streams.
 //
 // Example:
 //   BigInteger b(0);
@@ -100,7 +223,7 @@ class BigInteger
  public:
 
   typedef BigInteger                     self;
-  typedef std::vector<int16_t>           value_type;
+  typedef LimbVector                     value_type;
   typedef typename value_type::size_type size_type;
   typedef std::string                    string_type;
 
@@ -124,6 +247,11 @@ class BigInteger
   // Constructs with a string.
   BigInteger(const char* s);
 
+  // Constructs with the string s[0, n) or a string_view, which does not
+  // need to be null-terminated.
+  BigInteger(const char* s, size_t n);
+  explicit BigInteger(std::string_view s);
+
   BigInteger(const BigInteger& other);
   BigInteger(BigInteger&& other);
 
@@ -165,12 +293,29 @@ class BigInteger
   // better to use a variable to save the comparison results.
   int16_t compare(const self& other) const;
 
+  // Compares to an integer, the integer is not converted to a BigInteger.
+  template <typename T, typename = std::enable_if_t<
+    is_integer_e<T>, T>>
+  int16_t compare(const T& n) const;
+
   // Returns the number of decimal digits of this BigInteger.
   size_t digits() const;
 
   // Returns the maximum number of decimal digits.
   size_t max_digits() const;
 
+  // Returns the number of bits of the absolute value, zero has no bit.
+  size_t bit_length() const;
+
+  // Returns the nth bit in two's complement, a negative number has infinite
+  // one bits at the high end like the built-in signed integer.
+  // e.g. BigInteger(-2).test_bit(0) returns false, and test_bit(1000)
+  //      returns true.
+  bool test_bit(size_t n) const;
+
+  // Returns the number of one bits of the absolute value.
+  size_t popcount() const;
+
   // Returns the opposite number, does not modify itself.
   // e.g. BigInteger(123).opposite will returns BigInteger(-123).
   BigInteger opposite() const;
@@ -184,6 +329,37 @@ class BigInteger
   // otherwise, an exception will be thrown.
   BigInteger power(const BigInteger& n) const;
 
+  // Returns the square of this BigInteger, which is faster than
+  // multiplying by itself.
+  BigInteger square() const;
+
+  // Returns the quotient and the remainder of a / b by one division. The
+  // quotient is truncated toward zero, and the remainder has the symbol of
+  // a, the same as operator/ and operator%. e.g.
+  //   auto qr = BigInteger::divmod(-7, 2);        // (-3, -1)
+  static std::pair<BigInteger, BigInteger>
+  divmod(const BigInteger& a, const BigInteger& b);
+
+  // The same as divmod, but the quotient is rounded toward negative
+  // infinity, and the remainder has the symbol of b. e.g.
+  //   auto qr = BigInteger::floor_divmod(-7, 2);  // (-4, 1)
+  static std::pair<BigInteger, BigInteger>
+  floor_divmod(const BigInteger& a, const BigInteger& b);
+
+  // Returns the greatest common divisor and the least common multiple,
+  // which are not negative, gcd(0, 0) and lcm(x, 0) are zero.
+  static BigInteger gcd(const BigInteger& a, const BigInteger& b);
+  static BigInteger lcm(const BigInteger& a, const BigInteger& b);
+
+  // Returns (g, x, y) where g = gcd(a, b) and a * x + b * y = g. e.g.
+  //   auto [g, x, y] = BigInteger::extended_gcd(240, 46);  // (2, -9, 47)
+  static std::tuple<BigInteger, BigInteger, BigInteger>
+  extended_gcd(const BigInteger& a, const BigInteger& b);
+
+  // Returns x in [0, m) where a * x = 1 mod m, the modulus must be
+  // positive. An exception will be thrown if a is not invertible.
+  static BigInteger mod_inverse(const BigInteger& a, const BigInteger& m);
+
   // Returns a string of this number. If this BigInteger is negative,
   // there will be a negative sign, otherwise there will not be.
   // e.g. BigInteger(-123).to_string will returns std::string("-123").
@@ -232,6 +408,28 @@ class BigInteger
 
   void swap(BigInteger& rhs);
 
+  // Adds (subtracts) the product of a and b to this BigInteger, which does
+  // not build the product as a temporary when a or b has at most 64 bits.
+  // e.g. for an accumulation:
+  //   BigInteger sum(0);
+  //   for (size_t i = 0; i < n; ++i)
+  //     sum.addmul(x[i], w[i]);    // sum += x[i] * w[i]
+  BigInteger& addmul(const BigInteger& a, const BigInteger& b);
+  BigInteger& submul(const BigInteger& a, const BigInteger& b);
+
+  // Shifts n decimal digits, multiplies by 10^n if n is positive, otherwise
+  // divides by 10^-n, which is truncated toward zero.
+  // e.g. BigInteger(-1234).shift_digits(-2) becomes -12.
+  BigInteger& shift_digits(ptrdiff_t n);
+
+  // Keeps the n most significant decimal digits and sets the others to zero.
+  // truncate_digits truncates toward zero, and round_digits rounds half away
+  // from zero.
+  // e.g. BigInteger(-5678).truncate_digits(2) becomes -5600.
+  //      BigInteger(-5678).round_digits(2) becomes -5700.
+  BigInteger& truncate_digits(size_t n);
+  BigInteger& round_digits(size_t n);
+
   // --------------------------------------------------------------------------
   // Overloads for commonly used operators, which are member functions.
  public:
@@ -245,6 +443,35 @@ class BigInteger
   BigInteger& operator<<=(const BigInteger& rhs);
   BigInteger& operator>>=(const BigInteger& rhs);
 
+  // Shifts the limbs in O(n), x << n is the same as x * 2^n and x >> n is
+  // floor(x / 2^n), i.e. an arithmetic shift like the built-in signed
+  // integer, so x >> n rounds toward negative infinity if x is negative,
+  // e.g. BigInteger(-5) >> 1 == -3, and (x >> n).test_bit(0) equals
+  // x.test_bit(n). Use x / 2^n to round toward zero.
+  // The bitwise operators work on two's complement like the built-in signed
+  // integer, e.g. BigInteger(-6) & 0xFF == 250, ~BigInteger(5) == -6.
+  BigInteger& operator&=(const BigInteger& rhs);
+  BigInteger& operator|=(const BigInteger& rhs);
+  BigInteger& operator^=(const BigInteger& rhs);
+
+  // Arithmetic assignment operators with an integer, which work on the
+  // limbs by a single word and do not construct a BigInteger for it.
+  template <typename T, typename = std::enable_if_t<
+    is_integer_e<T>, T>>
+  BigInteger& operator+=(const T& rhs);
+  template <typename T, typename = std::enable_if_t<
+    is_integer_e<T>, T>>
+  BigInteger& operator-=(const T& rhs);
+  template <typename T, typename = std::enable_if_t<
+    is_integer_e<T>, T>>
+  BigInteger& operator*=(const T& rhs);
+  template <typename T, typename = std::enable_if_t<
+    is_integer_e<T>, T>>
+  BigInteger& operator/=(const T& rhs);
+  template <typename T, typename = std::enable_if_t<
+    is_integer_e<T>, T>>
+  BigInteger& operator%=(const T& rhs);
+
   // Pre-increment and pre-decrement.
   BigInteger& operator++();
   BigInteger& operator--();
@@ -257,6 +484,9 @@ class BigInteger
   BigInteger operator+();
   BigInteger operator-();
 
+  // Bitwise not, ~x == -x - 1.
+  BigInteger operator~() const;
+
   // --------------------------------------------------------------------------
   // Overloads for commonly used operators, which are friend functions.
  public:
@@ -268,9 +498,27 @@ class BigInteger
   friend BigInteger operator/(const BigInteger& lhs, const BigInteger& rhs);
   friend BigInteger operator%(const BigInteger& lhs, const BigInteger& rhs);
 
+  // Overloads for the expiring operands, the result reuses the storage of
+  // an rvalue operand, so `a * b + c * d - e` copies no operand.
+  friend BigInteger operator+(BigInteger&& lhs, const BigInteger& rhs);
+  friend BigInteger operator+(const BigInteger& lhs, BigInteger&& rhs);
+  friend BigInteger operator+(BigInteger&& lhs, BigInteger&& rhs);
+  friend BigInteger operator-(BigInteger&& lhs, const BigInteger& rhs);
+  friend BigInteger operator-(const BigInteger& lhs, BigInteger&& rhs);
+  friend BigInteger operator-(BigInteger&& lhs, BigInteger&& rhs);
+  friend BigInteger operator*(BigInteger&& lhs, const BigInteger& rhs);
+  friend BigInteger operator*(const BigInteger& lhs, BigInteger&& rhs);
+  friend BigInteger operator*(BigInteger&& lhs, BigInteger&& rhs);
+  friend BigInteger operator/(BigInteger&& lhs, const BigInteger& rhs);
+  friend BigInteger operator%(BigInteger&& lhs, const BigInteger& rhs);
+
   friend BigInteger operator<<(const BigInteger& lhs, const BigInteger& rhs);
   friend BigInteger operator>>(const BigInteger& lhs, const BigInteger& rhs);
 
+  friend BigInteger operator&(const BigInteger& lhs, const BigInteger& rhs);
+  friend BigInteger operator|(const BigInteger& lhs, const BigInteger& rhs);
+  friend BigInteger operator^(const BigInteger& lhs, const BigInteger& rhs);
+
   // Overloads comparison operators.
   friend bool operator==(const BigInteger& lhs, const BigInteger& rhs);
   friend bool operator!=(const BigInteger& lhs, const BigInteger& rhs);
@@ -279,46 +527,248 @@ class BigInteger
   friend bool operator<=(const BigInteger& lhs, const BigInteger& rhs);
   friend bool operator>=(const BigInteger& lhs, const BigInteger& rhs);
 
+  // Overloads arithmetic and comparison operators with an integer, which
+  // are faster than converting the integer to a BigInteger.
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator+(const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator-(const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator*(const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator/(const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator%(const BigInteger& lhs, const T& rhs);
+
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator+(BigInteger&& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator-(BigInteger&& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator*(BigInteger&& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator/(BigInteger&& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator%(BigInteger&& lhs, const T& rhs);
+
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator+(const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator-(const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator*(const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator+(const T& lhs, BigInteger&& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator-(const T& lhs, BigInteger&& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, BigInteger>
+  operator*(const T& lhs, BigInteger&& rhs);
+
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator==(const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator!=(const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator< (const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator> (const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator<=(const BigInteger& lhs, const T& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator>=(const BigInteger& lhs, const T& rhs);
+
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator==(const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator!=(const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator< (const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator> (const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator<=(const T& lhs, const BigInteger& rhs);
+  template <typename T>
+  friend std::enable_if_t<is_integer_e<T>, bool>
+  operator>=(const T& lhs, const BigInteger& rhs);
+
   // Overloads I/O stream operator.
   friend std::istream& operator>>(std::istream& is, BigInteger& b);
   friend std::ostream& operator<<(std::ostream& os, const BigInteger& b);
 
+  // The modular arithmetic works on the limbs directly.
+  friend class ModContext;
+
   // --------------------------------------------------------------------------
   // Helper functions.
  private:
 
-  void        _symbol_pos();
-  void        _symbol_neg();
-  int16_t     _group(size_t n) const;
-  size_t      _group_size() const;
-  void        _group_push(int16_t value);
-  void        _group_adjust(size_t n, int16_t value);
-  void        _clear_excess_zeros();
-  int64_t     _is_pow10() const;
-  NumberType  _is_integer(const char* sz);
+  void        _trim();
+  void        _grow(size_t n);
+  size_t      _bit_length() const;
   void        _integer_init(uint64_t n, SymbolType negative);
-  void        _string_init(const char* sz);
-  bool        _add_and_carry(size_t n, int16_t value);
-  std::string _group_to_string(size_t n) const;
+  void        _string_init(const char* s, size_t n);
+  void        _mul_add(uint64_t m, uint64_t a);
+  void        _increase();
+  void        _decrease();
   int16_t     _compare(const BigInteger& rhs) const;
   BigInteger& _plus_with_pos(const BigInteger& addend);
   BigInteger& _minus_with_pos(const BigInteger& subtrahend);
   BigInteger& _multiply_with_pos(const BigInteger& multiplier);
-  BigInteger& _divide_with_pos(const BigInteger& divisor);
+  BigInteger& _plus_word(uint64_t n);
+  BigInteger& _minus_word(uint64_t n);
+  BigInteger& _multiply_word(uint64_t n);
+  uint64_t    _divide_word(uint64_t n);
+  uint64_t    _mod_word(uint64_t n) const;
+  int16_t     _compare_word(uint64_t n) const;
+  BigInteger& _addmul(const BigInteger& a, const BigInteger& b,
+                      SymbolType op);
+
+  static BigInteger _read_decimal(const char* p, size_t n,
+                                  std::vector<BigInteger>& pow);
+  static char*      _write_decimal(const BigInteger& x, char* p,
+                                   size_t width,
+                                   const std::vector<BigInteger>& pow);
   BigInteger  _power_of(const BigInteger& n) const;
   void        _shift10(size_t n, ShiftType left);
-  BigInteger  _high_range(size_t n) const;
-  int16_t     _search(const BigInteger& dd, const BigInteger& ds) const;
+  void        _round10(size_t n, bool nearest);
+  void        _shift_left(size_t bits);
+  void        _shift_right(size_t bits);
+  BigInteger& _bitwise(const BigInteger& rhs, BitwiseType type);
+
+  uint64_t    _small() const;
+  void        _set_small(uint64_t n);
+
+  static BigInteger _pow10(size_t n);
+  static BigInteger _from_limbs(const uint32_t* p, size_t n);
+  static void       _multiply(uint32_t* r, const uint32_t* a, size_t an,
+                              const uint32_t* b, size_t bn);
+  static void       _karatsuba(uint32_t* r, const uint32_t* a, size_t an,
+                               const uint32_t* b, size_t bn);
+  static void       _toom3(uint32_t* r, const uint32_t* a, size_t an,
+                           const uint32_t* b, size_t bn);
+  static void       _divide(const BigInteger& a, const BigInteger& b,
+                            BigInteger& q, BigInteger& r);
+  static void       _divide_knuth(const BigInteger& a, const BigInteger& b,
+                                  BigInteger& q, BigInteger& r);
+  static void       _divide_bz(const BigInteger& a, const BigInteger& b,
+                               BigInteger& q, BigInteger& r);
+  static void       _divide_2n1n(const BigInteger& a, const BigInteger& b,
+                                 size_t n, BigInteger& q, BigInteger& r);
+  static void       _divide_3n2n(const BigInteger& a, const BigInteger& b,
+                                 size_t n, BigInteger& q, BigInteger& r);
+  static void       _gcd(BigInteger& a, BigInteger& b, BigInteger* s);
+  static void       _half_gcd(BigInteger& a, BigInteger& b, BigInteger* w);
+  static void       _gcd_divide(BigInteger& a, BigInteger& b,
+                                BigInteger* w, size_t cols);
+  static bool       _gcd_lehmer(BigInteger& a, BigInteger& b,
+                                BigInteger* w, size_t cols);
+  static void       _gcd_apply(BigInteger& a, BigInteger& b,
+                               const BigInteger* m, BigInteger* w,
+                               size_t cols);
+  static void       _gcd_rows(const BigInteger* m, BigInteger* w,
+                              size_t cols);
 
   // --------------------------------------------------------------------------
   // Member data.
  private:
 
-  // Divides a large integer into a group of four digits, that is, based on
-  // a system of 10000. The large integer stored in the vector by group from
-  // low bit to high bit. The type of each group is int16_t, the 14th bit of
-  // first group controls the symbol, it is negative when this bit is 1.
-  value_type number_;
+  // The absolute value is stored in 32-bit limbs, that is, based on a system
+  // of 2^32. The limbs are stored in the LimbVector from low to high, and
+  // there is no zero limb at the high end, so the zero has no limb. The
+  // symbol is stored separately, and the zero is always positive.
+  value_type limbs_;
+  SymbolType sign_;
+};
+
+// ============================================================================
+// ModContext class
+//
+// ModContext does the modular arithmetic with a fixed modulus, the constants
+// of Montgomery reduction and Barrett reduction are computed once when it is
+// constructed, so no long division is needed after each multiplication.
+// Montgomery reduction is used if the modulus is odd and not too large,
+// otherwise Barrett reduction is used.
+//
+// The results are always in [0, m). For a chain of multiplications, the
+// values can be kept in the form of the context by to_form, then be
+// multiplied by mul and sqr, and be converted back by from_form at last.
+//
+// Example:
+//   ModContext ctx(BigInteger("1000000007"));
+//   ctx.powmod(2, 100);             // 976371285
+//   ctx.invmod(2);                  // 500000004
+//   BigInteger x = ctx.to_form(3);
+//   BigInteger y = ctx.mul(x, x);
+//   ctx.from_form(y);               // 9
+class ModContext
+{
+ public:
+
+  // Constructs with the modulus, which must be positive.
+  explicit ModContext(const BigInteger& m);
+
+  // Returns the modulus.
+  const BigInteger& modulus() const;
+
+  // Returns x mod m in [0, m), x can be negative.
+  BigInteger reduce(const BigInteger& x) const;
+
+  // Converts x to the form of the context, and converts back.
+  BigInteger to_form(const BigInteger& x) const;
+  BigInteger from_form(const BigInteger& x) const;
+
+  // Multiplies and squares the values in the form of the context.
+  BigInteger mul(const BigInteger& a, const BigInteger& b) const;
+  BigInteger sqr(const BigInteger& a) const;
+
+  // Returns a * b mod m, a^e mod m and the inverse of a modulo m, a and b
+  // can be negative. If e is negative, a must be invertible. An exception
+  // will be thrown if a is not invertible.
+  BigInteger mulmod(const BigInteger& a, const BigInteger& b) const;
+  BigInteger powmod(const BigInteger& a, const BigInteger& e) const;
+  BigInteger invmod(const BigInteger& a) const;
+
+ private:
+
+  BigInteger _redc(BigInteger&& t) const;
+  BigInteger _barrett(BigInteger&& t) const;
+  BigInteger _reduce(BigInteger&& t) const;
+
+ private:
+
+  BigInteger modulus_;     // m
+  BigInteger mu_;          // 2^(64n) / m, n is the number of limbs of m
+  BigInteger r2_;          // R^2 mod m, R = 2^(32n)
+  BigInteger one_;         // The form of one
+  uint32_t   minv_;        // -1 / m mod 2^32
+  bool       montgomery_;
 };
 
 // ============================================================================
@@ -326,35 +776,317 @@ class BigInteger
 
 template <typename T, typename U>
 BigInteger::BigInteger(const T& n)
+  :sign_(kPositive)
 {
   _integer_init(static_cast<uint64_t>(
     redbud::safe_abs(n)), n < 0 ? kNegative : kPositive);
 }
 
+template <typename T, typename U>
+int16_t BigInteger::compare(const T& n) const
+{
+  SymbolType sign = n < 0 ? kNegative : kPositive;
+  if (sign_ != sign)
+  {
+    return sign_ == kPositive ? 1 : -1;
+  }
+  int16_t cmp = _compare_word(static_cast<uint64_t>(redbud::safe_abs(n)));
+  return sign_ == kPositive ? cmp : -cmp;
+}
+
+template <typename T, typename U>
+BigInteger& BigInteger::operator+=(const T& rhs)
+{
+  // x + y = x + y, (-x) + (-y) = -(x + y), otherwise subtracts.
+  uint64_t n = static_cast<uint64_t>(redbud::safe_abs(rhs));
+  return (rhs < 0) == is_negative() ? _plus_word(n) : _minus_word(n);
+}
+
+template <typename T, typename U>
+BigInteger& BigInteger::operator-=(const T& rhs)
+{
+  // x - (-y) = x + y, (-x) - y = -(x + y), otherwise subtracts.
+  uint64_t n = static_cast<uint64_t>(redbud::safe_abs(rhs));
+  return (rhs < 0) != is_negative() ? _plus_word(n) : _minus_word(n);
+}
+
+template <typename T, typename U>
+BigInteger& BigInteger::operator*=(const T& rhs)
+{
+  SymbolType sign = (rhs < 0) == is_negative() ? kPositive : kNegative;
+  _multiply_word(static_cast<uint64_t>(redbud::safe_abs(rhs)));
+  sign_ = is_zero() ? kPositive : sign;
+  return *this;
+}
+
+template <typename T, typename U>
+BigInteger& BigInteger::operator/=(const T& rhs)
+{
+  SymbolType sign = (rhs < 0) == is_negative() ? kPositive : kNegative;
+  _divide_word(static_cast<uint64_t>(redbud::safe_abs(rhs)));
+  sign_ = is_zero() ? kPositive : sign;
+  return *this;
+}
+
+template <typename T, typename U>
+BigInteger& BigInteger::operator%=(const T& rhs)
+{
+  // The remainder has the symbol of this BigInteger.
+  _set_small(_mod_word(static_cast<uint64_t>(redbud::safe_abs(rhs))));
+  return *this;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator+(const BigInteger& lhs, const T& rhs)
+{
+  BigInteger result(lhs);
+  result += rhs;
+  return result;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator-(const BigInteger& lhs, const T& rhs)
+{
+  BigInteger result(lhs);
+  result -= rhs;
+  return result;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator*(const BigInteger& lhs, const T& rhs)
+{
+  BigInteger result(lhs);
+  result *= rhs;
+  return result;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator/(const BigInteger& lhs, const T& rhs)
+{
+  BigInteger result(lhs);
+  result /= rhs;
+  return result;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator%(const BigInteger& lhs, const T& rhs)
+{
+  // Only the remainder is computed, the dividend is not copied.
+  BigInteger result(0);
+  result._set_small(
+    lhs._mod_word(static_cast<uint64_t>(redbud::safe_abs(rhs))));
+  result.sign_ = result.is_zero() ? kPositive : lhs.sign_;
+  return result;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator+(BigInteger&& lhs, const T& rhs)
+{
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator-(BigInteger&& lhs, const T& rhs)
+{
+  lhs -= rhs;
+  return std::move(lhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator*(BigInteger&& lhs, const T& rhs)
+{
+  lhs *= rhs;
+  return std::move(lhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator/(BigInteger&& lhs, const T& rhs)
+{
+  lhs /= rhs;
+  return std::move(lhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator%(BigInteger&& lhs, const T& rhs)
+{
+  lhs %= rhs;
+  return std::move(lhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator+(const T& lhs, const BigInteger& rhs)
+{
+  return rhs + lhs;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator-(const T& lhs, const BigInteger& rhs)
+{
+  // x - y = -(y - x)
+  BigInteger result(rhs);
+  result -= lhs;
+  result.reverse();
+  return result;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator*(const T& lhs, const BigInteger& rhs)
+{
+  return rhs * lhs;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator+(const T& lhs, BigInteger&& rhs)
+{
+  rhs += lhs;
+  return std::move(rhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator-(const T& lhs, BigInteger&& rhs)
+{
+  rhs -= lhs;
+  rhs.reverse();
+  return std::move(rhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, BigInteger>
+operator*(const T& lhs, BigInteger&& rhs)
+{
+  rhs *= lhs;
+  return std::move(rhs);
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator==(const BigInteger& lhs, const T& rhs)
+{
+  return lhs.compare(rhs) == 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator!=(const BigInteger& lhs, const T& rhs)
+{
+  return lhs.compare(rhs) != 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator<(const BigInteger& lhs, const T& rhs)
+{
+  return lhs.compare(rhs) < 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator>(const BigInteger& lhs, const T& rhs)
+{
+  return lhs.compare(rhs) > 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator<=(const BigInteger& lhs, const T& rhs)
+{
+  return lhs.compare(rhs) <= 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator>=(const BigInteger& lhs, const T& rhs)
+{
+  return lhs.compare(rhs) >= 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator==(const T& lhs, const BigInteger& rhs)
+{
+  return rhs.compare(lhs) == 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator!=(const T& lhs, const BigInteger& rhs)
+{
+  return rhs.compare(lhs) != 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator<(const T& lhs, const BigInteger& rhs)
+{
+  return rhs.compare(lhs) > 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator>(const T& lhs, const BigInteger& rhs)
+{
+  return rhs.compare(lhs) < 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator<=(const T& lhs, const BigInteger& rhs)
+{
+  return rhs.compare(lhs) >= 0;
+}
+
+template <typename T>
+std::enable_if_t<is_integer_e<T>, bool>
+operator>=(const T& lhs, const BigInteger& rhs)
+{
+  return rhs.compare(lhs) <= 0;
+}
+
 template <typename T>
 std::pair<T, bool> BigInteger::to_integer() const
 {
-  if (compare(BigInteger(std::numeric_limits<T>::min())) < 0 ||
-      compare(BigInteger(std::numeric_limits<T>::max())) > 0)
+  // The absolute value of an integer type has at most two limbs.
+  if (limbs_.size() > 2)
   {
-    return std::make_pair(0, false);
+    return std::make_pair(T(0), false);
   }
-  T n = 0;
+  uint64_t n = limbs_.empty() ? 0 : limbs_[0];
+  if (limbs_.size() == 2)
+  {
+    n |= static_cast<uint64_t>(limbs_[1]) << 32;
+  }
+  const uint64_t max = static_cast<uint64_t>(std::numeric_limits<T>::max());
   if (is_negative())
   {
-    for (int32_t i = _group_size() - 1; i >= 0; --i)
+    // The absolute value of the minimum is (max + 1) for a signed type.
+    if (!std::is_signed<T>::value || n > max + 1)
     {
-      n = n * 10000 - _group(i);
+      return std::make_pair(T(0), false);
     }
+    return std::make_pair(
+      static_cast<T>(-static_cast<int64_t>(n - 1) - 1), true);
   }
-  else
+  if (n > max)
   {
-    for (int32_t i = _group_size() - 1; i >= 0; --i)
-    {
-      n = n * 10000 + _group(i);
-    }
+    return std::make_pair(T(0), false);
   }
-  return std::make_pair(n, true);
+  return std::make_pair(static_cast<T>(n), true);
 }
 
 #if defined(REDBUD_MSVC)
@@ -364,6 +1096,7 @@ std::pair<T, bool> BigInteger::to_integer() const
 } // namespace redbud_bignumber
 
 typedef redbud_bignumber::BigInteger BigInteger;
+typedef redbud_bignumber::ModContext ModContext;
 
 } // namespace redbud
 #endif // !ALINSHANS_REDBUD_BIGNUMBER_H_
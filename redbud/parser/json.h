@@ -13,18 +13,34 @@
 #ifndef ALINSHANS_REDBUD_PARSER_JSON_H_
 #define ALINSHANS_REDBUD_PARSER_JSON_H_
 
+#include <cmath>             // isfinite, trunc
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>           // strtod
 
 #include <algorithm>
+#include <atomic>            // atomic
+#include <functional>        // less
+#include <istream>           // istream
+#include <iterator>          // begin, end, size
 #include <map>               // map
+#include <memory>            // allocator, allocator_traits
+#include <ostream>           // ostream
 #include <string>            // string
 #include <vector>            // vector
-#include <memory>            // shared_ptr
 #include <utility>           // pair, move, forward
 #include <initializer_list>  // initializer_list
 #include <type_traits>
 
+#include "json_columns.h"
+#include "json_parser.h"
+#include "json_value.h"
+#include "tokenizer.h"
+#include "../bignumber.h"
+#include "../exception.h"
+#include "../math.h"
 #include "../platform.h"
+#include "../__undef_minmax.h"
 
 namespace redbud
 {
@@ -40,12 +56,201 @@ using std::int64_t;
 using std::uint64_t;
 
 // ============================================================================
-// Forward declaration
+// Reference counting policies
+//
+// The JsonValue node is shared by the copies of Json, and it is counted by an
+// intrusive reference count embedded in the node. The policy decides the type
+// of the counter and how to increase or decrease it:
+//   JsonAtomicRef : the counter is atomic, the copies of a Json can be used
+//                   by different threads. This is the default one.
+//   JsonLocalRef  : the counter is a plain integer, there is no locked
+//                   instruction when copying a Json, but the copies of a Json
+//                   must never be used by different threads.
+//
+// Defines REDBUD_JSON_SINGLE_THREAD before including this file to use the
+// JsonLocalRef, it must be defined in the same way in every translation unit
+// of the program.
+
+struct JsonAtomicRef
+{
+  using count_t = std::atomic<size_t>;
+
+  static void increase(count_t& n)
+  {
+    n.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Returns true if the count becomes zero.
+  static bool decrease(count_t& n)
+  {
+    return n.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+};
+
+struct JsonLocalRef
+{
+  using count_t = size_t;
+
+  static void increase(count_t& n) { ++n; }
+  static bool decrease(count_t& n) { return --n == 0; }
+};
 
-class JsonValue;
+#if defined(REDBUD_JSON_SINGLE_THREAD)
+  using JsonRefPolicy = JsonLocalRef;
+#else
+  using JsonRefPolicy = JsonAtomicRef;
+#endif
 
 // ============================================================================
-// Json class
+// JsonNumberView class
+//
+// A read-only view of the numbers of a packed JSON array, likes std::span.
+// The JSON arrays whose elements are all numbers (time series, coordinates,
+// embeddings and so on) are packed into a contiguous buffer by the parser,
+// see BasicJson::is_packed() and BasicJson::as_numbers().
+//
+// The reductions are unrolled with four independent accumulators so that the
+// compiler can vectorize them, the results may differ from a sequential loop
+// in the last bits.
+class JsonNumberView
+{
+
+ public:
+
+  JsonNumberView(const double* data, size_t size) :data_(data), size_(size) {}
+
+  const double* data()  const { return data_; }
+  size_t        size()  const { return size_; }
+  bool          empty() const { return size_ == 0; }
+  const double* begin() const { return data_; }
+  const double* end()   const { return data_ + size_; }
+
+  double operator[](size_t i) const { return data_[i]; }
+
+  // Returns the sum of the numbers, 0 for an empty view.
+  double sum() const
+  {
+    double s[4] = { 0.0, 0.0, 0.0, 0.0 };
+    size_t i = 0;
+    for (; i + 4 <= size_; i += 4)
+    {
+      s[0] += data_[i];
+      s[1] += data_[i + 1];
+      s[2] += data_[i + 2];
+      s[3] += data_[i + 3];
+    }
+    for (; i < size_; ++i)
+    {
+      s[0] += data_[i];
+    }
+    return (s[0] + s[1]) + (s[2] + s[3]);
+  }
+
+  // Returns the minimum / maximum number, the view must not be empty.
+  double min() const
+  {
+    REDBUD_THROW_EX_IF(size_ == 0, "Json number view is empty.");
+    return _reduce([](double a, double b) { return b < a ? b : a; });
+  }
+
+  double max() const
+  {
+    REDBUD_THROW_EX_IF(size_ == 0, "Json number view is empty.");
+    return _reduce([](double a, double b) { return a < b ? b : a; });
+  }
+
+  // Returns the dot product, the two views must have the same size.
+  double dot(const JsonNumberView& other) const
+  {
+    REDBUD_THROW_EX_IF(size_ != other.size_, "Json number view size mismatch.");
+    const double* y = other.data_;
+    double s[4] = { 0.0, 0.0, 0.0, 0.0 };
+    size_t i = 0;
+    for (; i + 4 <= size_; i += 4)
+    {
+      s[0] += data_[i] * y[i];
+      s[1] += data_[i + 1] * y[i + 1];
+      s[2] += data_[i + 2] * y[i + 2];
+      s[3] += data_[i + 3] * y[i + 3];
+    }
+    for (; i < size_; ++i)
+    {
+      s[0] += data_[i] * y[i];
+    }
+    return (s[0] + s[1]) + (s[2] + s[3]);
+  }
+
+ private:
+
+  template <typename Op>
+  double _reduce(Op op) const
+  {
+    double r[4] = { data_[0], data_[0], data_[0], data_[0] };
+    size_t i = 0;
+    for (; i + 4 <= size_; i += 4)
+    {
+      r[0] = op(r[0], data_[i]);
+      r[1] = op(r[1], data_[i + 1]);
+      r[2] = op(r[2], data_[i + 2]);
+      r[3] = op(r[3], data_[i + 3]);
+    }
+    for (; i < size_; ++i)
+    {
+      r[0] = op(r[0], data_[i]);
+    }
+    return op(op(r[0], r[1]), op(r[2], r[3]));
+  }
+
+  const double* data_;
+  size_t        size_;
+
+};
+
+// ============================================================================
+// Details of the conversion from the C++ containers.
+namespace details
+{
+
+// True if T can be iterated by a range-based for loop.
+template <typename T, typename = void>
+struct is_range : std::false_type {};
+
+template <typename T>
+struct is_range<T, std::void_t<decltype(std::begin(std::declval<T&>())),
+                               decltype(std::end(std::declval<T&>()))>>
+  : std::true_type {};
+
+// True if std::size() can be called on T.
+template <typename T, typename = void>
+struct has_size : std::false_type {};
+
+template <typename T>
+struct has_size<T, std::void_t<decltype(std::size(std::declval<T&>()))>>
+  : std::true_type {};
+
+// True if T has reserve(n).
+template <typename T, typename = void>
+struct has_reserve : std::false_type {};
+
+template <typename T>
+struct has_reserve<T, std::void_t<
+  decltype(std::declval<T&>().reserve(std::size_t()))>> : std::true_type {};
+
+// The element type of a range.
+template <typename R>
+using element_t = std::remove_cv_t<std::remove_reference_t<
+  decltype(*std::begin(std::declval<R&>()))>>;
+
+// The ranges of the arithmetic types, except bool, are packed into a
+// contiguous buffer of double.
+template <typename T>
+constexpr bool packable_v = std::is_arithmetic_v<T> &&
+                            !std::is_same_v<T, bool>;
+
+} // namespace details
+
+// ============================================================================
+// BasicJson class
 //
 // This class is a JSON encoder/decoder, provides a series of interfaces
 // to parse, generate, modify and output a JSON. The type conversion table for
@@ -64,7 +269,33 @@ class JsonValue;
 // 
 // For more information please read this documents:
 // https://github.com/Alinshans/redbud/blob/master/document/parser/json.md
-class Json
+//
+// The template parameters decide where the memory comes from:
+//   Allocator : allocates the JsonValue nodes, and is rebound for the
+//               default containers. It is default constructed for each
+//               allocation and deallocation of a node, so it must be
+//               stateless: a per-request or per-thread pool only works
+//               through an allocator that forwards to a global or a
+//               thread_local pool, which also frees the memory of the
+//               other instances.
+//   StringT   : the string type, e.g. std::basic_string with an allocator.
+//   ArrayT    : the sequence container template for JSON array.
+//   ObjectT   : the associative container template for JSON object.
+//   RefPolicy : the reference counting policy, see above.
+//
+// Json is the BasicJson with the default arguments, e.g. a Json that all of
+// its memory comes from a pool:
+//   template <typename T> class PoolAllocator;
+//   using PoolString = std::basic_string<char, std::char_traits<char>,
+//                                        PoolAllocator<char>>;
+//   using PoolJson = BasicJson<PoolAllocator<char>, PoolString>;
+template <typename Allocator = std::allocator<char>,
+          typename StringT = std::string,
+          template <typename, typename> class ArrayT = std::vector,
+          template <typename, typename, typename, typename> class ObjectT
+            = std::map,
+          typename RefPolicy = JsonRefPolicy>
+class BasicJson
 {
 
   // --------------------------------------------------------------------------
@@ -89,147 +320,179 @@ class Json
     Pretty = 1
   };
 
-  // Alias declarations.
-  using string_t       = std::string;
-  using object_t       = std::map<string_t, Json>;
-  using array_t        = std::vector<Json>;
-  using array_value_t  = array_t::value_type;
-  using object_value_t = object_t::value_type;
+  // How the parser keeps the numbers which double can not represent exactly.
+  // The integers within 2^53 are always parsed into double, so the common
+  // numbers pay nothing.
+  enum class NumberPolicy
+  {
+    kDouble     = 0,  // Rounds all the numbers to double, the default.
+    kBigInteger = 1,  // Keeps the integers beyond 2^53, e.g. 128-bit IDs.
+    kText       = 2   // Also keeps the decimals, e.g. monetary amounts.
+  };
 
-  friend class JsonValue;
+  // Options of parse() and loads(), a NumberPolicy converts to it.
+  //
+  // In lazy mode, the numbers and the escaped strings keep a view of the
+  // JSON text, they are converted on the first access and the result is
+  // cached. dumps() writes them back in their original text, so passing a
+  // document through costs little more than scanning it. The nodes share
+  // the whole text, which lives as long as any of them does.
+  struct ParseOptions
+  {
+    ParseOptions(NumberPolicy n = NumberPolicy::kDouble, bool l = false)
+      :number(n), lazy(l)
+    {
+    }
+
+    NumberPolicy number;
+    bool         lazy;
+  };
+
+  // Alias declarations.
+  using allocator_type = Allocator;
+  using ref_policy     = RefPolicy;
+  using string_t       = StringT;
+  using array_t        = ArrayT<BasicJson, typename std::allocator_traits<
+    Allocator>::template rebind_alloc<BasicJson>>;
+  using object_t       = ObjectT<string_t, BasicJson, std::less<string_t>,
+    typename std::allocator_traits<Allocator>::template rebind_alloc<
+      std::pair<const string_t, BasicJson>>>;
+  using array_value_t  = typename array_t::value_type;
+  using object_value_t = typename object_t::value_type;
+  using number_array_t = std::vector<double, typename std::allocator_traits<
+    Allocator>::template rebind_alloc<double>>;
+
+  friend class JsonValue<BasicJson>;
+  friend class JsonParser<BasicJson>;
 
   // --------------------------------------------------------------------------
   // Static functions.
  public:
 
   // Decodes from a string, follows the rules of RFC 7159 and ECMA-404.
-  // if parses failed, it will yield an exception.
+  // if parses failed, it will yield an exception. The numbers kept by the
+  // policy are serialized back exactly, see is_bignum(). In lazy mode, the
+  // invalid surrogate pairs are reported when the string is accessed.
 
-  static Json parse(const string_t& json);
-  static Json parse(string_t&& json);
+  static BasicJson parse(const string_t& json,
+                         ParseOptions options = ParseOptions());
+  static BasicJson parse(string_t&& json,
+                         ParseOptions options = ParseOptions());
 
   // Serializes any object that can be converted to Json to Json.
 
   template <typename T, typename std::enable_if_t<
-    std::is_constructible_v<Json, T>, int> = 0>
-  static Json to_json(T&& value) { return value; }
-
-  // for native array
-  template <typename T, size_t N1>
-  static Json to_json(T(&v)[N1])
-  {
-    static_assert(std::is_constructible_v<Json, T>, 
-                  "the type can not be converted to Json");
-    Json json = array_t{};
-    std::for_each(std::begin(v), std::end(v), [&json](const T& value) {
-      json.push_back(value);
-    });
-    return json;
-  }
-
-  template <typename T, size_t N1, size_t N2>
-  static Json to_json(T(&v)[N1][N2])
+    std::is_constructible_v<BasicJson, T>, int> = 0>
+  static BasicJson to_json(T&& value)
   {
-    static_assert(std::is_constructible_v<Json, T>,
-                  "the type can not be converted to Json");
-    Json json = array_t{};
-    std::for_each(std::begin(v), std::end(v), [&json](T(&v2)[N2]) {
-      json.push_back(to_json(v2));
-    });
-    return json;
+    return BasicJson(std::forward<T>(value));
   }
 
-  template <typename T, size_t N1, size_t N2, size_t N3>
-  static Json to_json(T(&v)[N1][N2][N3])
+  // for native array of any rank
+  template <typename T, size_t N>
+  static BasicJson to_json(T(&v)[N])
   {
-    static_assert(std::is_constructible_v<Json, T>,
-                  "the type can not be converted to Json");
-    Json json = array_t{};
-    std::for_each(std::begin(v), std::end(v), [&json](T(&v2)[N2][N3]) {
-      json.push_back(to_json(v2));
-    });
-    return json;
-  }
-
-  template <typename T, size_t N1, size_t N2, size_t N3, size_t N4>
-  static Json to_json(T(&v)[N1][N2][N3][N4])
-  {
-    static_assert(std::is_constructible_v<Json, T>,
-                  "the type can not be converted to Json");
-    Json json = array_t{};
-    std::for_each(std::begin(v), std::end(v), [&json](T(&v2)[N2][N3][N4]) {
-      json.push_back(to_json(v2));
-    });
-    return json;
-  }
-
-  template <typename T, size_t N1, size_t N2, size_t N3, size_t N4, size_t N5>
-  static Json to_json(T(&v)[N1][N2][N3][N4][N5])
-  {
-    static_assert(std::is_constructible_v<Json, T>,
-                  "the type can not be converted to Json");
-    Json json = array_t{};
-    std::for_each(std::begin(v), std::end(v), [&json](T(&v2)[N2][N3][N4][N5]) {
-      json.push_back(to_json(v2));
-    });
-    return json;
+    static_assert(
+      std::is_constructible_v<BasicJson, std::remove_all_extents_t<T>>,
+      "the type can not be converted to Json");
+    if constexpr (std::is_array_v<T>)
+    {
+      array_t arr;
+      if constexpr (details::has_reserve<array_t>::value)
+      {
+        arr.reserve(N);
+      }
+      for (auto& e : v)
+      {
+        arr.emplace_back(to_json(e));
+      }
+      return BasicJson(std::move(arr));
+    }
+    else
+    {
+      return _to_array(v);
+    }
   }
 
   // for initializer_list
-  static Json to_json(std::initializer_list<Json> ilist);
+  static BasicJson to_json(std::initializer_list<BasicJson> ilist);
 
   // --------------------------------------------------------------------------
   // Constructor / Copy constructor / Move constructor / Destructor
  public:
 
   // Default constructor, makes this Json have a null value.
-  Json();
+  BasicJson();
 
   // Constructs a Json with the corresponding JsonValue in C++.
 
-  Json(std::nullptr_t);   // null
-  Json(bool);             // bool
-  Json(int32_t);          // number
-  Json(uint32_t);         // number
-  Json(int64_t);          // number
-  Json(uint64_t);         // number
-  Json(double);           // number
-  Json(char*);            // string
-  Json(const char*);      // string
-  Json(const string_t&);  // string
-  Json(string_t&&);       // string
-  Json(const array_t&);   // array
-  Json(array_t&&);        // array
-  Json(const object_t&);  // object
-  Json(object_t&&);       // object
+  BasicJson(std::nullptr_t);   // null
+  BasicJson(bool);             // bool
+  BasicJson(int32_t);          // number
+  BasicJson(uint32_t);         // number
+  BasicJson(int64_t);          // number
+  BasicJson(uint64_t);         // number
+  BasicJson(double);           // number
+  BasicJson(char*);            // string
+  BasicJson(const char*);      // string
+  BasicJson(const string_t&);  // string
+  BasicJson(string_t&&);       // string
+  BasicJson(const array_t&);   // array
+  BasicJson(array_t&&);        // array
+  BasicJson(const object_t&);  // object
+  BasicJson(object_t&&);       // object
+
+  // Constructs a packed JSON array, see is_packed().
+  BasicJson(const number_array_t&);
+  BasicJson(number_array_t&&);
+
+  // Constructs a number which keeps all the digits, see is_bignum().
+  BasicJson(const BigInteger&);
 
   // Constructs form object-like container like std::map, std::unordered_map.
+  // The values of an rvalue container are moved, and the keys in order
+  // (e.g. from std::map) are inserted in linear time.
   template <typename M, typename std::enable_if_t<
-    std::is_constructible_v<Json, typename M::key_type>
-    && std::is_constructible_v<Json, typename M::mapped_type>, int> = 0>
-  Json(const M& value) :Json(object_t(value.begin(), value.end())) {}
+    std::is_constructible_v<BasicJson, typename std::decay_t<M>::key_type>
+    && std::is_constructible_v<BasicJson,
+                               typename std::decay_t<M>::mapped_type>
+    && !std::is_same_v<std::decay_t<M>, object_t>, int> = 0>
+  BasicJson(M&& value)
+    :BasicJson(_to_object(std::forward<M>(value)))
+  {
+  }
 
-  // Constructs form array-like container like std::vector, std::list.
+  // Constructs form array-like container like std::vector, std::list, or a
+  // span. The array is reserved once if the size is known, the elements of
+  // an rvalue container are moved, and the numbers are packed, see
+  // is_packed(). The nested containers are converted recursively.
   template <typename A, typename std::enable_if_t<
-    std::is_constructible_v<Json, typename A::value_type>, int> = 0>
-  Json(const A& value) :Json(array_t(value.begin(), value.end())) {}
+    std::is_constructible_v<BasicJson, typename std::decay_t<A>::value_type>
+    && details::is_range<std::decay_t<A>>::value
+    && !std::is_same_v<std::decay_t<A>, array_t>
+    && !std::is_same_v<std::decay_t<A>, number_array_t>
+    && !std::is_same_v<std::decay_t<A>, string_t>, int> = 0>
+  BasicJson(A&& value)
+    :BasicJson(_to_array(std::forward<A>(value)))
+  {
+  }
 
-  Json(const Json&);
-  Json(Json&&);
+  BasicJson(const BasicJson&);
+  BasicJson(BasicJson&&);
 
   // Deletes all constructors with a raw pointer. Because the JsonValue
-  // is stored in a std::shared_ptr, and passes a raw pointer to a
-  // std::shared_ptr constructor is no a good idea.
+  // is shared by reference count, and passes a raw pointer to a Json
+  // is no a good idea.
   template <typename T>
-  Json(T*) = delete;
+  BasicJson(T*) = delete;
 
-  ~Json() = default;
+  ~BasicJson();
 
   // --------------------------------------------------------------------------
   // Copy assignment operator / Move assignment operator
 
-  Json& operator=(const Json&);
-  Json& operator=(Json&&);
+  BasicJson& operator=(const BasicJson&);
+  BasicJson& operator=(BasicJson&&);
 
   // --------------------------------------------------------------------------
   // initializer_list
@@ -237,8 +500,8 @@ class Json
   // Some places should be noted and please see:
   // https://github.com/Alinshans/redbud/blob/master/document/parser/json.md#initializer_list
   
-  Json(std::initializer_list<Json> ilist);
-  Json& operator=(std::initializer_list<Json> ilist);
+  BasicJson(std::initializer_list<BasicJson> ilist);
+  BasicJson& operator=(std::initializer_list<BasicJson> ilist);
 
   // --------------------------------------------------------------------------
 
@@ -267,10 +530,47 @@ class Json
   const array_t&  as_array()  const;
   const object_t& as_object() const;
 
+  // True if this is a JSON array whose numbers are stored in a contiguous
+  // buffer. The parser packs the arrays whose elements are all numbers.
+  // Appending numbers and operator[] keep an array packed, the numbers are
+  // refreshed from the elements after they are modified through operator[]
+  // and the array is no longer packed if one of them is not a number. The
+  // other modifications unpack it. The generic interface, e.g. as_array()
+  // or operator[], builds a Json for each element on the first call, the
+  // as_numbers() does not.
+  bool is_packed() const;
+
+  // Gets a view of the numbers of a packed array, if the array is not
+  // packed, it will yield an exception.
+  JsonNumberView as_numbers() const;
+
+  // True if this is a number which keeps its original text, because it was
+  // parsed with a NumberPolicy or constructed from a BigInteger. as_double()
+  // of such a number returns the nearest double.
+  bool is_bignum() const;
+
+  // Converts an integer number to BigInteger without rounding, if this is
+  // not a number or the number is not an integer, it will yield an exception.
+  BigInteger as_bignum() const;
+
+  // Gets the text of a number, which is the original text if is_bignum(),
+  // otherwise the same as dumps(). If this is not a number, it will yield
+  // an exception.
+  string_t as_number_text() const;
+
+  // True if this is a number or a string parsed in lazy mode, which keeps
+  // its original text, see ParseOptions.
+  bool is_lazy() const;
+
+  // Converts a JSON array of objects into typed columns, see JsonColumns.
+  // If this is not such an array, it will yield an exception.
+  JsonColumns<BasicJson> to_columns() const;
+
   // Gets or sets JsonValue of this Json, this type must be a JSON array,
-  // otherwise, an exception will be thrown.
-  Json&       operator[](size_t index);
-  const Json& operator[](size_t index) const;
+  // otherwise, an exception will be thrown. To read a number of a packed
+  // array without building the elements, use as_numbers()[index].
+  BasicJson&       operator[](size_t index);
+  const BasicJson& operator[](size_t index) const;
 
   // Gets or sets JsonValue of this Json, this type must be a JSON object,
   // otherwise, an exception will be thrown. the keys of the JSON object
@@ -278,8 +578,8 @@ class Json
   //
   // Some places should be noted and please see:
   // https://github.com/Alinshans/redbud/blob/master/document/parser/json.md#operator-with-a-jsonobject
-  Json&       operator[](const string_t& key);
-  const Json& operator[](const string_t& key) const;
+  BasicJson&       operator[](const string_t& key);
+  const BasicJson& operator[](const string_t& key) const;
 
   // Return value correspondence table:
   // Json type      return value
@@ -322,8 +622,8 @@ class Json
   //
   // Some places should be noted and please see:
   // https://github.com/Alinshans/redbud/blob/master/document/parser/json.md#merge-rule
-  Json& merge(Json& other);
-  Json& merge(Json&& other);
+  BasicJson& merge(BasicJson& other);
+  BasicJson& merge(BasicJson&& other);
 
   // Serializes this JSON and saves the result in str.
   void dumps(string_t& str) const;
@@ -332,8 +632,8 @@ class Json
   string_t dumps() const;
 
   // Passes in a string, and saves the parsed result in this Json.
-  void loads(const string_t& str);
-  void loads(string_t&& str);
+  void loads(const string_t& str, ParseOptions options = ParseOptions());
+  void loads(string_t&& str, ParseOptions options = ParseOptions());
 
   // Output this Json text, the first parameter can be set to the
   // output format(the default is PrintType::Compact), and the second
@@ -351,39 +651,1398 @@ class Json
   // operator>> will parse the input string first, so if the input string
   // is a invalid JSON value, it will yield an exception.
 
-  friend std::ostream& operator<<(std::ostream& os, const Json& j);
-  friend std::istream& operator>>(std::istream& is, Json& j);
+  friend std::ostream& operator<<(std::ostream& os, const BasicJson& j)
+  {
+    j.print(PrintType::Compact);
+    return os;
+  }
+
+  friend std::istream& operator>>(std::istream& is, BasicJson& j)
+  {
+    string_t json_buf;
+    std::getline(is, json_buf, '\n');
+    j = parse(std::move(json_buf));
+    return is;
+  }
 
   // Overloads comparation operator.
 
-  friend bool operator==(const Json& lhs, const Json& rhs);
-  friend bool operator!=(const Json& lhs, const Json& rhs);
+  friend bool operator==(const BasicJson& lhs, const BasicJson& rhs)
+  {
+    return lhs._equals(rhs);
+  }
+
+  friend bool operator!=(const BasicJson& lhs, const BasicJson& rhs)
+  {
+    return !lhs._equals(rhs);
+  }
 
   // --------------------------------------------------------------------------
   // Private member data and member functions.
 
  private:
 
+  // Helper functions for comparation.
+  bool _equals(const BasicJson& other) const;
+  bool _is_integer() const;
+
   // Helper functions for merge.
-  Json& _merge_array(Json&& other);
-  Json& _merge_object(Json&& other);
+  BasicJson& _merge_array(BasicJson&& other);
+  BasicJson& _merge_object(BasicJson&& other);
 
   // The following functions are designed for serialization.
-  void _dumps_from(const Json& j, string_t& str) const;
+  void _dumps_from(const BasicJson& j, string_t& str) const;
   void _dumps_string(const string_t& s, string_t& str) const;
   void _dumps_array(const array_t& a, string_t& str) const;
+  void _dumps_numbers(const number_array_t& a, string_t& str) const;
   void _dumps_object(const object_t& o, string_t& str) const;
 
+  // Helper functions for the conversion from the C++ containers.
+  template <typename R>
+  static BasicJson _to_array(R&& range);
+  template <typename M>
+  static BasicJson _to_object(M&& map);
+
+  // Makes a number which keeps its text, used by the parser.
+  static BasicJson _make_bignum(string_t&& text, double d);
+
+  // Makes the lazy nodes, used by the parser.
+  static BasicJson _make_lazy_number(JsonTextView&& text);
+  static BasicJson _make_lazy_string(JsonTextView&& text);
+
+  // Makes a node by the allocator, see JsonValue::make.
+  template <template <typename> class Node, typename... Args>
+  static JsonValue<BasicJson>* _make(Args&&... args);
+
+  // Releases the node and takes the ownership of the new node.
+  void _reset(JsonValue<BasicJson>* node);
+
   // The following three functions are designed for output.
+  void _print_number(const BasicJson& j) const;
   void _print_array(PrintType t, size_t ind, size_t dep) const;
   void _print_object(PrintType t, size_t ind, size_t dep) const;
   void _indentation(PrintType t, size_t ind, size_t dep) const;
 
-  // JsonValue node.
-  std::shared_ptr<JsonValue> node_;
+  // JsonValue node, which is shared by reference count.
+  JsonValue<BasicJson>* node_;
 
 };
 
+// Json is the BasicJson with the default template arguments.
+using Json = BasicJson<>;
+
+// ============================================================================
+// Implementation of BasicJson.
+
+#if defined(REDBUD_MSVC)
+  #pragma warning(push)
+  #pragma warning(disable : 6031) // return value ignored
+#endif
+
+// ----------------------------------------------------------------------------
+// Macro definition.
+
+#define REDBUD_JSON_TEMPLATE                                                \
+  template <typename Allocator, typename StringT,                           \
+            template <typename, typename> class ArrayT,                     \
+            template <typename, typename, typename, typename> class ObjectT,\
+            typename RefPolicy>
+
+#define REDBUD_BASIC_JSON \
+  BasicJson<Allocator, StringT, ArrayT, ObjectT, RefPolicy>
+
+#define EXPECT_BOOL                                     \
+  REDBUD_THROW_EX_IF(type() != Type::kJsonBool,         \
+                  "Expecting a boolean.");
+
+#define EXPECT_NUMBER                                   \
+  REDBUD_THROW_EX_IF(type() != Type::kJsonNumber,       \
+                  "Expecting a number.");
+
+#define EXPECT_STRING                                   \
+  REDBUD_THROW_EX_IF(type() != Type::kJsonString,       \
+                  "Expecting a string.");
+
+#define EXPECT_ARRAY                                    \
+  REDBUD_THROW_EX_IF(type() != Type::kJsonArray,        \
+                  "Expecting a Json array.")
+
+#define EXPECT_OBJECT                                   \
+  REDBUD_THROW_EX_IF(type() != Type::kJsonObject,       \
+                  "Expecting a Json object.");
+
+// ----------------------------------------------------------------------------
+// Static functions.
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON REDBUD_BASIC_JSON::parse(const string_t& json_text,
+                                           ParseOptions options)
+{
+  return JsonParser<BasicJson>::parse(json_text, options);
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON REDBUD_BASIC_JSON::parse(string_t&& json_text,
+                                           ParseOptions options)
+{
+  return JsonParser<BasicJson>::parse(std::move(json_text), options);
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON
+REDBUD_BASIC_JSON::to_json(std::initializer_list<BasicJson> ilist)
+{
+  return ilist;
+}
+
+// ----------------------------------------------------------------------------
+// Constructor / Copy constructor / Move constructor / Destructor
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson()
+  :node_(_make<JsonNull>())
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(std::nullptr_t)
+  :node_(_make<JsonNull>())
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(bool b)
+  :node_(_make<JsonBool>(b))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(int32_t n)
+  :node_(_make<JsonNumber>(n))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(uint32_t n)
+  :node_(_make<JsonNumber>(n))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(int64_t n)
+  :node_(_make<JsonNumber>(n))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(uint64_t n)
+  :node_(_make<JsonNumber>(n))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(double d)
+  :node_(_make<JsonNumber>(d))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(char* sz)
+  :node_(_make<JsonString>(sz))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(const char* sz)
+  :node_(_make<JsonString>(sz))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(const string_t& str)
+  :node_(_make<JsonString>(str))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(string_t&& str)
+  :node_(_make<JsonString>(std::move(str)))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(const array_t& a)
+  :node_(_make<JsonArray>(a))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(array_t&& a)
+  :node_(_make<JsonArray>(std::move(a)))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(const object_t& o)
+  :node_(_make<JsonObject>(o))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(object_t&& o)
+  :node_(_make<JsonObject>(std::move(o)))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(const number_array_t& a)
+  :node_(_make<JsonPackedArray>(a))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(number_array_t&& a)
+  :node_(_make<JsonPackedArray>(std::move(a)))
+{
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(const BigInteger& n)
+  :node_(nullptr)
+{
+  const std::string text = n.to_string();
+  _reset(_make<JsonBigNumber>(string_t(text.data(), text.size()),
+                              std::strtod(text.c_str(), nullptr)));
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(const BasicJson& j)
+  :node_(j.node_)
+{
+  if (node_ != nullptr)
+  {
+    node_->add_ref();
+  }
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(BasicJson&& j)
+  :node_(j.node_)
+{
+  j.node_ = nullptr;
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::~BasicJson()
+{
+  if (node_ != nullptr)
+  {
+    node_->release();
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Copy assignment operator / Move assignment operator
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::operator=(const BasicJson& j)
+{
+  if (j.node_ != nullptr)
+  {
+    j.node_->add_ref();
+  }
+  _reset(j.node_);
+  return *this;
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::operator=(BasicJson&& j)
+{
+  if (this != &j)
+  {
+    _reset(j.node_);
+    j.node_ = nullptr;
+  }
+  return *this;
+}
+
+// ----------------------------------------------------------------------------
+// initializer_list
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON::BasicJson(std::initializer_list<BasicJson> ilist)
+  :node_(nullptr)
+{
+  bool maybe_object =
+    std::all_of(ilist.begin(), ilist.end(), [&ilist](const BasicJson& v)
+  {
+    return v.is_array() && v.size() == 2 && v[0].is_string();
+  });
+
+  if (maybe_object)
+  {
+    _reset(_make<JsonObject>());
+    std::for_each(ilist.begin(), ilist.end(), [this](const BasicJson& v)
+    {
+      insert({ v[0].as_string(),v[1] });
+    });
+  }
+  else // not maybe_object
+  {
+    _reset(_make<JsonArray>(ilist));
+  }
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON&
+REDBUD_BASIC_JSON::operator=(std::initializer_list<BasicJson> ilist)
+{
+  bool maybe_object =
+    std::all_of(ilist.begin(), ilist.end(), [&ilist](const BasicJson& v)
+  {
+    return v.is_array() && v.size() == 2 && v[0].is_string();
+  });
+
+  if (maybe_object)
+  {
+    _reset(_make<JsonObject>());
+    std::for_each(ilist.begin(), ilist.end(), [this](const BasicJson& v)
+    {
+      insert({ v[0].as_string(),v[1] });
+    });
+  }
+  else // not maybe_object
+  {
+    _reset(_make<JsonArray>(ilist));
+  }
+  return *this;
+}
+
+// ----------------------------------------------------------------------------
+// Type interface.
+
+REDBUD_JSON_TEMPLATE
+typename REDBUD_BASIC_JSON::Type REDBUD_BASIC_JSON::type() const
+{
+  return node_->type();
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_null() const
+{
+  return type() == Type::kJsonNull;
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_bool() const
+{
+  return type() == Type::kJsonBool;
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_number() const
+{
+  return type() == Type::kJsonNumber;
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_string() const
+{
+  return type() == Type::kJsonString;
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_array() const
+{
+  return type() == Type::kJsonArray;
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_object() const
+{
+  return type() == Type::kJsonObject;
+}
+
+// ----------------------------------------------------------------------------
+// Data interface.
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::as_bool() const
+{
+  EXPECT_BOOL;
+  return node_->get_bool_safe();
+}
+
+REDBUD_JSON_TEMPLATE
+int32_t REDBUD_BASIC_JSON::as_int32() const
+{
+  EXPECT_NUMBER;
+  return static_cast<int32_t>(node_->get_double_safe());
+}
+
+REDBUD_JSON_TEMPLATE
+uint32_t REDBUD_BASIC_JSON::as_uint32() const
+{
+  EXPECT_NUMBER;
+  return static_cast<uint32_t>(node_->get_double_safe());
+}
+
+REDBUD_JSON_TEMPLATE
+int64_t REDBUD_BASIC_JSON::as_int64() const
+{
+  EXPECT_NUMBER;
+  return static_cast<int64_t>(node_->get_double_safe());
+}
+
+REDBUD_JSON_TEMPLATE
+uint64_t REDBUD_BASIC_JSON::as_uint64() const
+{
+  EXPECT_NUMBER;
+  return static_cast<uint64_t>(node_->get_double_safe());
+}
+
+REDBUD_JSON_TEMPLATE
+double REDBUD_BASIC_JSON::as_double() const
+{
+  EXPECT_NUMBER;
+  return node_->get_double_safe();
+}
+
+REDBUD_JSON_TEMPLATE
+const typename REDBUD_BASIC_JSON::string_t& REDBUD_BASIC_JSON::as_string() const
+{
+  EXPECT_STRING;
+  return node_->get_string_safe();
+}
+
+REDBUD_JSON_TEMPLATE
+const typename REDBUD_BASIC_JSON::array_t& REDBUD_BASIC_JSON::as_array() const
+{
+  EXPECT_ARRAY;
+  return node_->get_array_safe();
+}
+
+REDBUD_JSON_TEMPLATE
+const typename REDBUD_BASIC_JSON::object_t& REDBUD_BASIC_JSON::as_object() const
+{
+  EXPECT_OBJECT;
+  return node_->get_object_safe();
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_packed() const
+{
+  return is_array() &&
+    static_cast<const JsonArray<BasicJson>*>(node_)->numbers() != nullptr;
+}
+
+REDBUD_JSON_TEMPLATE
+JsonNumberView REDBUD_BASIC_JSON::as_numbers() const
+{
+  REDBUD_THROW_EX_IF(!is_packed(), "Expecting a packed Json array.");
+  auto numbers = static_cast<const JsonArray<BasicJson>*>(node_)->numbers();
+  return JsonNumberView(numbers->data(), numbers->size());
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_bignum() const
+{
+  return is_number() && node_->get_number_text() != nullptr;
+}
+
+REDBUD_JSON_TEMPLATE
+BigInteger REDBUD_BASIC_JSON::as_bignum() const
+{
+  EXPECT_NUMBER;
+  const string_t* text = node_->get_number_text();
+  if (text != nullptr)
+  {
+    // BigInteger also reads the integers in scientific notation, e.g.
+    // "1.20e2", and rejects the others.
+    return BigInteger(text->data(), text->size());
+  }
+  double d = as_double();
+  REDBUD_THROW_EX_IF(std::trunc(d) != d, "Expecting an integer.");
+  // The integer value of a double has at most 309 digits.
+  char buf[320];
+  std::snprintf(buf, sizeof(buf), "%.0f", d);
+  return BigInteger(static_cast<const char*>(buf));
+}
+
+REDBUD_JSON_TEMPLATE
+typename REDBUD_BASIC_JSON::string_t REDBUD_BASIC_JSON::as_number_text() const
+{
+  EXPECT_NUMBER;
+  const string_t* text = node_->get_number_text();
+  if (text != nullptr)
+  {
+    return *text;
+  }
+  if (const JsonTextView* raw = node_->raw())
+  {
+    return string_t(raw->data(), raw->len);
+  }
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.17g", as_double());
+  return string_t(buf);
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::is_lazy() const
+{
+  return node_ != nullptr && node_->raw() != nullptr;
+}
+
+REDBUD_JSON_TEMPLATE
+JsonColumns<REDBUD_BASIC_JSON> REDBUD_BASIC_JSON::to_columns() const
+{
+  EXPECT_ARRAY;
+  return JsonColumns<BasicJson>(*this);
+}
+
+// ----------------------------------------------------------------------------
+// Accesses / modifies data via operator[].
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::operator[](size_t index)
+{
+  EXPECT_ARRAY;
+  REDBUD_THROW_EX_IF(size() <= index, "Json index out of range.");
+  return node_->get_value_from_arr(index);
+}
+
+REDBUD_JSON_TEMPLATE
+const REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::operator[](size_t index) const
+{
+  EXPECT_ARRAY;
+  REDBUD_THROW_EX_IF(size() <= index, "Json index out of range.");
+  // Reads through a const node, so a packed array is not unpacked.
+  const JsonValue<BasicJson>* node = node_;
+  return node->get_value_from_arr(index);
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::operator[](const string_t& key)
+{
+  if (type() == Type::kJsonNull)
+  {
+    *this = object_t{};
+    return node_->get_value_from_obj(key);
+  }
+  EXPECT_OBJECT;
+  return node_->get_value_from_obj(key);
+}
+
+REDBUD_JSON_TEMPLATE
+const REDBUD_BASIC_JSON&
+REDBUD_BASIC_JSON::operator[](const string_t& key) const
+{
+  EXPECT_OBJECT;
+  return node_->get_value_from_obj(key);
+}
+
+// ----------------------------------------------------------------------------
+// STL-like access.
+
+REDBUD_JSON_TEMPLATE
+size_t REDBUD_BASIC_JSON::size() const
+{
+  if (type() == Type::kJsonNull)
+  {
+    return 0;
+  }
+  return node_->size();
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::empty() const
+{
+  return size() == 0;
+}
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::has_key(const string_t& key) const
+{
+  EXPECT_OBJECT;
+  auto&& obj = as_object();
+  return obj.find(key) != obj.end();
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::push_back(const array_value_t& element)
+{
+  if (type() == Type::kJsonNull)
+  {
+    *this = array_t{};
+    node_->push_back(element);
+    return;
+  }
+  EXPECT_ARRAY;
+  node_->push_back(element);
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::push_back(array_value_t&& element)
+{
+  if (type() == Type::kJsonNull)
+  {
+    *this = array_t{};
+    node_->push_back(std::move(element));
+    return;
+  }
+  EXPECT_ARRAY;
+  node_->push_back(std::move(element));
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::pop_back()
+{
+  EXPECT_ARRAY;
+  REDBUD_THROW_EX_IF(size() == 0, "Json has no value before pop.");
+  node_->pop_back();
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::insert(const object_value_t& pair)
+{
+  if (type() == Type::kJsonNull)
+  {
+    *this = object_t{};
+    node_->insert(pair);
+    return;
+  }
+  EXPECT_OBJECT;
+  node_->insert(pair);
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::insert(object_value_t&& pair)
+{
+  if (type() == Type::kJsonNull)
+  {
+    *this = object_t{};
+    node_->insert(std::move(pair));
+    return;
+  }
+  EXPECT_OBJECT;
+  node_->insert(std::move(pair));
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::erase(size_t i)
+{
+  EXPECT_ARRAY;
+  node_->erase(i);
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::erase(const string_t& key)
+{
+  EXPECT_OBJECT;
+  node_->erase(key);
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::clear()
+{
+  _reset(_make<JsonNull>());
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::merge(BasicJson& other)
+{
+  return merge(std::move(other));
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::merge(BasicJson&& other)
+{
+  if (other.type() == Type::kJsonNull)
+  {
+    return *this;
+  }
+  if (type() == Type::kJsonNull)
+  {
+    *this = std::move(other);
+    other.clear();
+    return *this;
+  }
+  if (type() != Type::kJsonArray && type() != Type::kJsonObject
+      && other.type() != Type::kJsonArray && other.type() != Type::kJsonObject)
+  {
+    BasicJson tmp = array_t{};
+    tmp.push_back(std::move(*this));
+    tmp.push_back(std::move(other));
+    *this = std::move(tmp);
+    other.clear();
+    return *this;
+  }
+  if (type() == Type::kJsonObject && other.type() == Type::kJsonObject)
+  {
+    return _merge_object(std::move(other));
+  }
+  return _merge_array(std::move(other));
+}
+
+// ----------------------------------------------------------------------------
+// Serialization / Deserialization
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::dumps(string_t& str) const
+{
+  str.clear();
+  str.reserve(size() << 6);
+  _dumps_from(*this, str);
+}
+
+REDBUD_JSON_TEMPLATE
+typename REDBUD_BASIC_JSON::string_t REDBUD_BASIC_JSON::dumps() const
+{
+  string_t str;
+  dumps(str);
+  return str;
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::loads(const string_t & str, ParseOptions options)
+{
+  *this = JsonParser<BasicJson>::parse(str, options);
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::loads(string_t&& str, ParseOptions options)
+{
+  *this = JsonParser<BasicJson>::parse(std::move(str), options);
+}
+
+// ----------------------------------------------------------------------------
+// Output.
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::print(PrintType t, size_t ind) const
+{
+  if (node_ == nullptr)
+  {
+    return;
+  }
+  switch (type())
+  {
+    case Type::kJsonNull:
+      std::printf("null");
+      break;
+    case Type::kJsonBool:
+      std::printf("%s", as_bool() ? "true" : "false");
+      break;
+    case Type::kJsonNumber:
+      _print_number(*this);
+      break;
+    case Type::kJsonString:
+      std::printf("%s", as_string().c_str());
+      break;
+    case Type::kJsonArray:
+      _print_array(t, ind, 0);
+      break;
+    case Type::kJsonObject:
+      _print_object(t, ind, 0);
+      break;
+    
+    // This Json has no value.
+    default:
+      break;
+  }
+}
+
+// ============================================================================
+// Helper functions.
+
+REDBUD_JSON_TEMPLATE
+template <typename R>
+REDBUD_BASIC_JSON REDBUD_BASIC_JSON::_to_array(R&& range)
+{
+  using element_type = details::element_t<R>;
+  if constexpr (details::packable_v<element_type>)
+  {
+    number_array_t numbers;
+    if constexpr (details::has_size<R>::value)
+    {
+      numbers.reserve(std::size(range));
+    }
+    for (const auto& e : range)
+    {
+      numbers.push_back(static_cast<double>(e));
+    }
+    return BasicJson(std::move(numbers));
+  }
+  else
+  {
+    array_t arr;
+    if constexpr (details::has_size<R>::value &&
+                  details::has_reserve<array_t>::value)
+    {
+      arr.reserve(std::size(range));
+    }
+    for (auto&& e : range)
+    {
+      if constexpr (std::is_lvalue_reference_v<R>)
+      {
+        arr.emplace_back(e);
+      }
+      else
+      {
+        arr.emplace_back(std::move(e));
+      }
+    }
+    return BasicJson(std::move(arr));
+  }
+}
+
+REDBUD_JSON_TEMPLATE
+template <typename M>
+REDBUD_BASIC_JSON REDBUD_BASIC_JSON::_to_object(M&& map)
+{
+  object_t obj;
+  for (auto&& p : map)
+  {
+    // Inserting at the end takes constant time if the key is the largest.
+    if constexpr (std::is_lvalue_reference_v<M>)
+    {
+      obj.emplace_hint(obj.end(), p.first, p.second);
+    }
+    else
+    {
+      obj.emplace_hint(obj.end(), p.first, std::move(p.second));
+    }
+  }
+  return BasicJson(std::move(obj));
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON REDBUD_BASIC_JSON::_make_bignum(string_t&& text, double d)
+{
+  BasicJson j;
+  j._reset(_make<JsonBigNumber>(std::move(text), d));
+  return j;
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON REDBUD_BASIC_JSON::_make_lazy_number(JsonTextView&& text)
+{
+  BasicJson j;
+  j._reset(_make<JsonLazyNumber>(std::move(text)));
+  return j;
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON REDBUD_BASIC_JSON::_make_lazy_string(JsonTextView&& text)
+{
+  BasicJson j;
+  j._reset(_make<JsonLazyString>(std::move(text)));
+  return j;
+}
+
+REDBUD_JSON_TEMPLATE
+template <template <typename> class Node, typename... Args>
+JsonValue<REDBUD_BASIC_JSON>* REDBUD_BASIC_JSON::_make(Args&&... args)
+{
+  return JsonValue<BasicJson>::template make<Node>(
+    std::forward<Args>(args)...);
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_reset(JsonValue<BasicJson>* node)
+{
+  if (node_ != nullptr)
+  {
+    node_->release();
+  }
+  node_ = node;
+}
+
+// Merges with another Json.
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::_merge_array(BasicJson&& other)
+{
+  if (type() == Type::kJsonArray && other.type() == Type::kJsonArray)
+  {
+    for (size_t i = 0; i < other.size(); ++i)
+    {
+      push_back(std::move(other[i]));
+    }
+  }
+  else if (type() == Type::kJsonArray)
+  {
+    push_back(std::move(other));
+  }
+  else if (other.type() == Type::kJsonArray)
+  {
+    BasicJson tmp = array_t{};
+    tmp.push_back(std::move(*this));
+    for (size_t i = 0; i < other.size(); ++i)
+    {
+      tmp.push_back(std::move(other[i]));
+    }
+    *this = std::move(tmp);
+  }
+  else
+  {
+    BasicJson tmp = array_t{};
+    tmp.push_back(std::move(*this));
+    tmp.push_back(std::move(other));
+    *this = std::move(tmp);
+  }
+  other.clear();
+  return *this;
+}
+
+REDBUD_JSON_TEMPLATE
+REDBUD_BASIC_JSON& REDBUD_BASIC_JSON::_merge_object(BasicJson&& other)
+{
+  auto&& obj = other.as_object();
+  for (auto&& value : obj)
+  {
+    insert(std::move(value));
+  }
+  other.clear();
+  return *this;
+}
+
+// Serialization.
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_dumps_from(const BasicJson& j, string_t& str) const
+{
+  if (j.is_lazy())
+  {  // Writes back the original text, without decoding it.
+    const JsonTextView* raw = j.node_->raw();
+    if (j.is_string())
+    {
+      str.push_back('\"');
+      str.append(raw->data(), raw->len);
+      str.push_back('\"');
+      return;
+    }
+    str.append(raw->data(), raw->len);
+    return;
+  }
+  switch (j.type())
+  {
+    case Type::kJsonNull:
+      str.append("null");
+      break;
+    case Type::kJsonBool:
+      str.append(j.as_bool() ? "true" : "false");
+      break;
+    case Type::kJsonNumber:
+      if (j.is_bignum())
+      {
+        str.append(*j.node_->get_number_text());
+        break;
+      }
+      char buf[32]; // (-) + (17 digits) + (.) + (e) + (-) + (3 digits)
+      std::snprintf(buf, sizeof(buf), "%.17g", j.as_double());
+      str.append(buf);
+      break;
+    case Type::kJsonString:
+      _dumps_string(j.as_string(), str);
+      break;
+    case Type::kJsonArray:
+      if (j.is_packed())
+      {
+        _dumps_numbers(*static_cast<const JsonArray<BasicJson>*>(
+          j.node_)->numbers(), str);
+        break;
+      }
+      _dumps_array(j.as_array(), str);
+      break;
+    case Type::kJsonObject:
+      _dumps_object(j.as_object(), str);
+      break;
+    
+    // This Json has no value.
+    default:
+      break;
+  }
+}
+
+#define GETC(ch)       static_cast<uint8_t>(ch)
+#define PUTC(ch)       str.push_back(static_cast<char>(ch))
+#define CODE(bin, pre) (static_cast<uint8_t>(bin) & pre)
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_dumps_string(const string_t& s, string_t& str) const
+{
+  PUTC('\"');
+  for (size_t i = 0; i < s.size(); ++i)
+  {
+#if 1
+    if (Token::escape(s[i]))
+    {
+      PUTC('\\');
+    }
+    PUTC(s[i]);
+#else
+    if (Token::escape(s[i]))
+    {
+      PUTC('\\');
+      PUTC(s[i]);
+    }
+    else if (GETC(s[i]) <= 0x7F)
+    { // One byte : 0xxxxxxx  
+      // Preserves ASCII characters.
+      PUTC(s[i]);
+    }
+    else if (GETC(s[i]) <= 0xDF)
+    { // Two bytes : 110xxxxx  10xxxxxx
+      uint32_t u = (CODE(s[i], 0x1F) << 6) |
+                   (CODE(s[i + 1], 0x3F));
+      char buf[7];
+      std::snprintf(buf, sizeof(buf), "\\u%04X", u);
+      str.append(buf);
+      i += 1;
+    }
+    else if (GETC(s[i]) <= 0xEF)
+    { // Three bytes : 1110xxxx  10xxxxxx  10xxxxxx
+      uint32_t u = (CODE(s[i], 0xF) << 12) |
+                   (CODE(s[i + 1], 0x3F) << 6) |
+                   (CODE(s[i + 2], 0x3F));
+      char buf[7];
+      std::snprintf(buf, sizeof(buf), "\\u%04X", u);
+      str.append(buf);
+      i += 2;
+    }
+    else if (GETC(s[i]) <= 0xF7)
+    { // Four bytes : 11110xxx 	10xxxxxx 	10xxxxxx 	10xxxxxx
+      // Deal with surrogate pair.
+      uint32_t u = (CODE(s[i], 0x7) << 18) |
+                   (CODE(s[i + 1], 0x3F) << 12) |
+                   (CODE(s[i + 2], 0x3F) << 6) |
+                   (CODE(s[i + 3], 0x3F));
+      u -= 0x10000;
+      char buf[7];
+      std::snprintf(buf, sizeof(buf), "\\u%04X", (u >> 10) + 0xD800);
+      str.append(buf);
+      std::snprintf(buf, sizeof(buf), "\\u%04X", (u & 0x3FF) + 0xDC00);
+      str.append(buf);
+      i += 3;
+    }
+#endif  // convert unicode to \uxxxx
+  }
+  PUTC('\"');
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_dumps_array(const array_t& a, string_t& str) const
+{
+  bool begin = true;
+  PUTC('[');
+  for (const auto& j : a)
+  {
+    if (!begin)
+    {
+      PUTC(',');
+    }
+    _dumps_from(j, str);
+    begin = false;
+  }
+  PUTC(']');
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_dumps_numbers(const number_array_t& a,
+                                       string_t& str) const
+{
+  char buf[32];
+  PUTC('[');
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    if (i != 0)
+    {
+      PUTC(',');
+    }
+    std::snprintf(buf, sizeof(buf), "%.17g", a[i]);
+    str.append(buf);
+  }
+  PUTC(']');
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_dumps_object(const object_t& o, string_t& str) const
+{
+  bool begin = true;
+  PUTC('{');
+  for (const auto& p : o)
+  {
+    if (!begin)
+    {
+      PUTC(',');
+    }
+    _dumps_string(p.first, str);
+    PUTC(':');
+    _dumps_from(p.second, str);
+    begin = false;
+  }
+  PUTC('}');
+}
+
+#undef GETC
+#undef PUTC
+#undef CODE
+
+// Output.
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_print_number(const BasicJson& j) const
+{
+  if (j.is_bignum())
+  {
+    std::printf("%s", j.node_->get_number_text()->c_str());
+    return;
+  }
+  if (const JsonTextView* raw = j.node_->raw())
+  {
+    std::printf("%.*s", static_cast<int>(raw->len), raw->data());
+    return;
+  }
+  std::printf("%.17g", j.as_double());
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_print_array(PrintType t, size_t ind, size_t dep) const
+{
+  if (size() == 0)
+  {
+    std::printf("[]");
+    return;
+  }
+  std::printf("[");
+  auto last = as_array().cend();
+  --last;
+  for (auto it = as_array().cbegin(); it != as_array().cend(); ++it)
+  {
+    _indentation(t, ind, dep + 1);
+    switch (it->type())
+    {
+      case Type::kJsonNull:
+        std::printf("null");
+        break;
+      case Type::kJsonBool:
+        std::printf("%s", it->as_bool() ? "true" : "false");
+        break;
+      case Type::kJsonNumber:
+        _print_number(*it);
+        break;
+      case Type::kJsonString:
+        std::printf("\"%s\"", it->as_string().c_str());
+        break;
+      case Type::kJsonArray:
+        it->_print_array(t, ind, dep + 1);
+        break;
+      case Type::kJsonObject:
+        it->_print_object(t, ind, dep + 1);
+        break;
+    }
+    if (it != last && it->type() != Type::kJsonNull)
+    {
+      std::printf(",");
+    }
+  }
+  _indentation(t, ind, dep);
+  std::printf("]");
+}
+
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_print_object(PrintType t, size_t ind, size_t dep) const
+{
+  if (size() == 0)
+  {
+    std::printf("{}");
+    return;
+  }
+  std::printf("{");
+  auto last = as_object().cend();
+  --last;
+  for (auto it = as_object().cbegin(); it != as_object().cend(); ++it)
+  {
+    _indentation(t, ind, dep + 1);
+    t == PrintType::Compact ? std::printf("\"%s\":", it->first.c_str())
+      : std::printf("\"%s\" : ", it->first.c_str());
+    switch (it->second.type())
+    {
+      case Type::kJsonNull:
+        std::printf("null");
+        break;
+      case Type::kJsonBool:
+        std::printf("%s", it->second.as_bool() ? "true" : "false");
+        break;
+      case Type::kJsonNumber:
+        _print_number(it->second);
+        break;
+      case Type::kJsonString:
+        std::printf("\"%s\"", it->second.as_string().c_str());
+        break;
+      case Type::kJsonArray:
+        it->second._print_array(t, ind, dep + 1);
+        break;
+      case Type::kJsonObject:
+        it->second._print_object(t, ind, dep + 1);
+        break;
+    }
+    if (it != last)
+    {
+      std::printf(",");
+    }
+  }
+  _indentation(t, ind, dep);
+  std::printf("}");
+}
+
+// Controls indentation.
+REDBUD_JSON_TEMPLATE
+void REDBUD_BASIC_JSON::_indentation(PrintType t, size_t ind, size_t dep) const
+{
+  // Only PrintType::Pretty has indentation.
+  if (t == PrintType::Pretty)
+  {
+    std::printf("\n");
+    for (size_t i = 0; i < ind * dep; ++i)
+    {
+      std::printf(" ");
+    }
+  }
+}
+
+// Comparation.
+
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::_equals(const BasicJson& other) const
+{
+  if (type() != other.type()) return false;
+  switch (type())
+  {
+    case Type::kJsonNull:
+      return true;
+      break;
+    case Type::kJsonBool:
+      return as_bool() == other.as_bool();
+      break;
+    case Type::kJsonNumber:
+      // The numbers which keep their text are compared by value, e.g. "1e2"
+      // equals "100", and exactly if both of them are integers.
+      if ((is_bignum() || other.is_bignum())
+          && _is_integer() && other._is_integer())
+      {
+        return as_bignum() == other.as_bignum();
+      }
+      return safe_abs(as_double() - other.as_double()) < 0.0000000000000001;
+      break;
+    case Type::kJsonString:
+      return as_string() == other.as_string();
+      break;
+    case Type::kJsonArray:
+      if (is_packed() && other.is_packed())
+      {
+        auto x = as_numbers();
+        auto y = other.as_numbers();
+        return x.size() == y.size() &&
+          std::equal(x.begin(), x.end(), y.begin(), [](double a, double b) {
+          return safe_abs(a - b) < 0.0000000000000001;
+        });
+      }
+      return as_array() == other.as_array();
+      break;
+    case Type::kJsonObject:
+      return as_object() == other.as_object();
+      break;
+    default:
+      break;
+  }
+  return false;
+}
+
+// True if this number is an integer that as_bignum() accepts, the text of a
+// bignum is checked by the same rules as BigInteger, i.e. an integer or
+// "a.bEn" where n is not less than the number of digits of b.
+REDBUD_JSON_TEMPLATE
+bool REDBUD_BASIC_JSON::_is_integer() const
+{
+  const string_t* text = node_->get_number_text();
+  if (text == nullptr)
+  {
+    double d = as_double();
+    return std::isfinite(d) && std::trunc(d) == d;
+  }
+  auto p = text->begin(), end = text->end();
+  if (p != end && (*p == '+' || *p == '-'))
+  {
+    ++p;
+  }
+  if (p == end || *p < '0' || *p > '9')
+  {
+    return false;
+  }
+  if (*p == '0')
+  {
+    return p + 1 == end;
+  }
+  auto first = p;
+  for (++p; p != end && '0' <= *p && *p <= '9'; ++p)
+    ; // Empty loop body
+  if (p == end)
+  {
+    return true;
+  }
+  if (p != first + 1)
+  {
+    return false;
+  }
+  size_t fraction = 0;
+  if (*p == '.')
+  {
+    auto f = ++p;
+    for (; p != end && '0' <= *p && *p <= '9'; ++p)
+      ; // Empty loop body
+    fraction = static_cast<size_t>(p - f);
+  }
+  if (p == end || (*p != 'e' && *p != 'E'))
+  {
+    return false;
+  }
+  if (++p != end && *p == '+')
+  {
+    ++p;
+  }
+  if (p == end || *p < '1' || *p > '9')
+  {
+    return false;
+  }
+  size_t shift = 0;
+  for (; p != end && '0' <= *p && *p <= '9'; ++p)
+  {
+    if (shift < fraction)
+    {
+      shift = shift * 10 + static_cast<size_t>(*p - '0');
+    }
+  }
+  return p == end && shift >= fraction;
+}
+
+#undef REDBUD_JSON_TEMPLATE
+#undef REDBUD_BASIC_JSON
+#undef EXPECT_BOOL
+#undef EXPECT_NUMBER
+#undef EXPECT_STRING
+#undef EXPECT_ARRAY
+#undef EXPECT_OBJECT
+
+#if defined(REDBUD_MSVC)
+  #pragma warning(pop)
+#endif
+
+// The default Json is instantiated in json.cc and json_parser.cc.
+extern template class BasicJson<>;
+extern template class JsonParser<Json>;
+
 } // namespace json
 } // namespace parser
 } // namespace redbud
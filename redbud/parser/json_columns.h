@@ -0,0 +1,867 @@
+// ============================================================================
+// Copyright (c) 2017 Alinshans. All rights reserved.
+// Licensed under the MIT License. See LICENSE for details.
+//
+// Header File : redbud/parser/json_columns.h
+//
+// This file contains a JsonColumns class, which stores a JSON array of
+// objects as typed columns.
+// ============================================================================
+
+#ifndef ALINSHANS_REDBUD_PARSER_JSON_COLUMNS_H_
+#define ALINSHANS_REDBUD_PARSER_JSON_COLUMNS_H_
+
+#include <cmath>             // trunc
+#include <cstdint>
+
+#include <algorithm>         // min, max
+#include <bitset>            // bitset
+#include <charconv>          // from_chars
+#include <functional>        // less
+#include <limits>            // numeric_limits
+#include <map>               // map
+#include <memory>            // allocator_traits
+#include <utility>           // pair, move
+#include <vector>            // vector
+
+#include "json_parser.h"
+#include "../exception.h"
+#include "../__undef_minmax.h"
+
+namespace redbud
+{
+namespace parser
+{
+namespace json
+{
+
+// ============================================================================
+// JsonColumns class
+//
+// This class converts a JSON array of objects (records) into a table with
+// one column per key, so that a scan runs over contiguous memory. A column
+// is typed by its values:
+//   bool                     -> kBool
+//   integral numbers         -> kInt64 (kDouble once a decimal appears)
+//   other numbers            -> kDouble
+//   strings                  -> kString, dictionary encoded
+// The null values and the missing keys are recorded in a null bitmap, a
+// column only of nulls has kNull. The values must be scalars and a column
+// can not mix numbers, booleans and strings, otherwise it will yield an
+// exception. The integer literals within the range of int64 are read
+// exactly, so parse() keeps e.g. the 64-bit ids, while to_columns() of a
+// Json reads them exactly only if they keep their text, see NumberPolicy.
+//
+// The filters return a mask with one bit per row, the aggregations skip
+// the nulls and accept a mask to select the rows.
+//
+// Example:
+//   auto t = Json::parse(text).to_columns();  // or JsonColumns<Json>::parse
+//   auto m = t["v"].compare_number(JsonColumns<Json>::Compare::kGreater, 0);
+//   t["v"].sum(&m);
+template <typename JsonT>
+class JsonColumns
+{
+
+  // --------------------------------------------------------------------------
+  // Type definition.
+ public:
+
+  using string_t = typename JsonT::string_t;
+
+  template <typename T>
+  using vector_t = std::vector<T, typename std::allocator_traits<
+    typename JsonT::allocator_type>::template rebind_alloc<T>>;
+
+  template <typename T>
+  using index_t = std::map<string_t, T, std::less<string_t>,
+    typename std::allocator_traits<typename JsonT::allocator_type>::
+      template rebind_alloc<std::pair<const string_t, T>>>;
+
+  // A selection of rows, the bit (i % 64) of word (i / 64) is row i.
+  using mask_t = vector_t<uint64_t>;
+
+  enum class ColumnType
+  {
+    kNull   = 0,
+    kBool   = 1,
+    kInt64  = 2,
+    kDouble = 3,
+    kString = 4
+  };
+
+  enum class Compare
+  {
+    kEqual        = 0,
+    kNotEqual     = 1,
+    kLess         = 2,
+    kLessEqual    = 3,
+    kGreater      = 4,
+    kGreaterEqual = 5
+  };
+
+  // --------------------------------------------------------------------------
+  // Column class
+  class Column
+  {
+
+   public:
+
+    friend class JsonColumns;
+    friend class JsonParser<JsonT>;
+
+    Column(const string_t& name, size_t nulls);
+
+    const string_t& name() const { return name_; }
+    ColumnType      type() const { return type_; }
+    size_t          size() const { return size_; }
+    size_t          null_count() const { return nulls_; }
+    bool            is_null(size_t i) const;
+
+    // Gets the data of the corresponding type, the nulls are stored as
+    // zero. The strings are stored as the indexes of the dictionary.
+    const uint8_t*            bools()   const { return bools_.data(); }
+    const int64_t*            int64s()  const { return int64s_.data(); }
+    const double*             doubles() const { return doubles_.data(); }
+    const uint32_t*           codes()   const { return codes_.data(); }
+    const vector_t<string_t>& dictionary() const { return dictionary_; }
+
+    // Gets the value of row i, if the types do not match or the value is
+    // null, it will yield an exception. as_double() also reads kInt64.
+    bool            as_bool(size_t i)   const;
+    int64_t         as_int64(size_t i)  const;
+    double          as_double(size_t i) const;
+    const string_t& as_string(size_t i) const;
+
+    // Selects the rows whose value satisfies `value op x`, the nulls are
+    // never selected. compare_number() is for kInt64 and kDouble, and the
+    // others are for the corresponding type.
+    mask_t compare_number(Compare op, double x) const;
+    mask_t compare_string(Compare op, const string_t& x) const;
+    mask_t compare_bool(bool x) const;
+
+    // Aggregates the non-null values of the rows selected by the mask (all
+    // the rows if it is nullptr), only for kInt64 and kDouble except count.
+    // min(), max() and mean() of no value will yield an exception.
+    size_t count(const mask_t* mask = nullptr) const;
+    double sum(const mask_t* mask = nullptr)   const;
+    double min(const mask_t* mask = nullptr)   const;
+    double max(const mask_t* mask = nullptr)   const;
+    double mean(const mask_t* mask = nullptr)  const;
+
+   private:
+
+    // Appends a value, used by JsonColumns and the parser.
+    void _push_null();
+    void _push_bool(bool b);
+    void _push_number(double d);
+    void _push_string(const string_t& s);
+
+    // Appends the integer written in s[0, n) exactly, returns false without
+    // appending if it is not an integer literal within the range of int64.
+    bool _push_integer(const char* s, size_t n);
+
+    // Removes the last value, for the repeated keys in a record.
+    void _pop();
+
+    void _set_type(ColumnType t);
+    void _push_valid(bool valid);
+    void _check_mask(const mask_t* mask) const;
+
+    // Sets the bits of the rows where f(i) is true, then clears the nulls.
+    template <typename F>
+    mask_t _select(F f) const;
+
+    template <typename T, typename U>
+    mask_t _compare(const T* p, Compare op, const U& x) const;
+
+    template <typename T>
+    double _sum(const T* p, const mask_t* mask) const;
+
+    template <typename T, typename F>
+    double _reduce(const T* p, const mask_t* mask, T init, F f) const;
+
+    string_t            name_;
+    ColumnType          type_;
+    size_t              size_;
+    size_t              nulls_;
+    mask_t              valid_;
+    vector_t<uint8_t>   bools_;
+    vector_t<int64_t>   int64s_;
+    vector_t<double>    doubles_;
+    vector_t<uint32_t>  codes_;
+    vector_t<string_t>  dictionary_;
+    index_t<uint32_t>   codes_of_;
+
+  };
+
+  // --------------------------------------------------------------------------
+  // Constructor
+ public:
+
+  // Constructs an empty table.
+  JsonColumns() :rows_(0) {}
+
+  // Converts a JSON array of objects, see BasicJson::to_columns().
+  explicit JsonColumns(const JsonT& records);
+
+  // Parses a JSON array of objects into columns directly, without building
+  // a JsonT for the records.
+  static JsonColumns parse(const string_t& text);
+
+  // --------------------------------------------------------------------------
+  // Element access.
+ public:
+
+  // The number of rows and columns, the columns are in the order of their
+  // first appearance.
+  size_t rows() const { return rows_; }
+  size_t column_count() const { return columns_.size(); }
+
+  const Column& column(size_t i) const { return columns_[i]; }
+
+  // Gets a column by the key, if the key does not exist, operator[] will
+  // yield an exception, find() returns nullptr.
+  const Column& operator[](const string_t& key) const;
+  const Column* find(const string_t& key) const;
+
+  // Combines two masks, and counts the selected rows of a mask.
+  static mask_t mask_and(const mask_t& a, const mask_t& b);
+  static mask_t mask_or(const mask_t& a, const mask_t& b);
+  static size_t mask_count(const mask_t& m);
+
+  // --------------------------------------------------------------------------
+  // Private member data and member functions.
+ private:
+
+  friend class JsonParser<JsonT>;
+
+  // Gets the column of the key, makes it if it does not exist. The keys of
+  // the records are usually in the same order, so the i-th column is tried
+  // first for the i-th key.
+  Column& _column(const string_t& key, size_t i);
+
+  // Prepares a column to take the value of the current row.
+  Column& _field(const string_t& key, size_t i);
+
+  // Finishes the current row, fills the missing keys with nulls.
+  void _end_row();
+
+  vector_t<Column> columns_;
+  index_t<size_t>  index_;
+  size_t           rows_;
+
+};
+
+// ============================================================================
+// Implementation of JsonColumns.
+
+#define REDBUD_JSON_COLUMNS JsonColumns<JsonT>
+
+// ----------------------------------------------------------------------------
+// Column.
+
+template <typename JsonT>
+REDBUD_JSON_COLUMNS::Column::Column(const string_t& name, size_t nulls)
+  :name_(name), type_(ColumnType::kNull), size_(nulls), nulls_(nulls),
+   valid_((nulls + 63) / 64, 0)
+{
+}
+
+template <typename JsonT>
+bool REDBUD_JSON_COLUMNS::Column::is_null(size_t i) const
+{
+  REDBUD_THROW_EX_IF(i >= size_, "Index out of range.");
+  return ((valid_[i / 64] >> (i % 64)) & 1) == 0;
+}
+
+template <typename JsonT>
+bool REDBUD_JSON_COLUMNS::Column::as_bool(size_t i) const
+{
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kBool || is_null(i),
+                     "Expecting a boolean.");
+  return bools_[i] != 0;
+}
+
+template <typename JsonT>
+int64_t REDBUD_JSON_COLUMNS::Column::as_int64(size_t i) const
+{
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kInt64 || is_null(i),
+                     "Expecting an integer.");
+  return int64s_[i];
+}
+
+template <typename JsonT>
+double REDBUD_JSON_COLUMNS::Column::as_double(size_t i) const
+{
+  REDBUD_THROW_EX_IF(is_null(i), "Expecting a number.");
+  if (type_ == ColumnType::kInt64)
+  {
+    return static_cast<double>(int64s_[i]);
+  }
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kDouble, "Expecting a number.");
+  return doubles_[i];
+}
+
+template <typename JsonT>
+const typename REDBUD_JSON_COLUMNS::string_t&
+REDBUD_JSON_COLUMNS::Column::as_string(size_t i) const
+{
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kString || is_null(i),
+                     "Expecting a string.");
+  return dictionary_[codes_[i]];
+}
+
+// ----------------------------------------------------------------------------
+// Filters.
+
+template <typename JsonT>
+typename REDBUD_JSON_COLUMNS::mask_t
+REDBUD_JSON_COLUMNS::Column::compare_number(Compare op, double x) const
+{
+  switch (type_)
+  {
+    case ColumnType::kInt64:  return _compare(int64s_.data(), op, x);
+    case ColumnType::kDouble: return _compare(doubles_.data(), op, x);
+    case ColumnType::kNull:   return mask_t(valid_.size(), 0);
+    default:
+      REDBUD_THROW_EX_IF(true, "Expecting a number column.");
+  }
+  return{};  // Ignores the warning.
+}
+
+template <typename JsonT>
+typename REDBUD_JSON_COLUMNS::mask_t
+REDBUD_JSON_COLUMNS::Column::compare_string(Compare op,
+                                            const string_t& x) const
+{
+  if (type_ == ColumnType::kNull)
+  {
+    return mask_t(valid_.size(), 0);
+  }
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kString,
+                     "Expecting a string column.");
+  // Compares each string of the dictionary once, then selects the rows by
+  // their codes.
+  vector_t<uint8_t> hits(dictionary_.size(), 0);
+  for (size_t k = 0; k < dictionary_.size(); ++k)
+  {
+    const string_t& s = dictionary_[k];
+    switch (op)
+    {
+      case Compare::kEqual:        hits[k] = s == x; break;
+      case Compare::kNotEqual:     hits[k] = s != x; break;
+      case Compare::kLess:         hits[k] = s < x;  break;
+      case Compare::kLessEqual:    hits[k] = s <= x; break;
+      case Compare::kGreater:      hits[k] = s > x;  break;
+      case Compare::kGreaterEqual: hits[k] = s >= x; break;
+    }
+  }
+  const uint8_t* h = hits.data();
+  const uint32_t* c = codes_.data();
+  return _select([h, c](size_t i) { return h[c[i]] != 0; });
+}
+
+template <typename JsonT>
+typename REDBUD_JSON_COLUMNS::mask_t
+REDBUD_JSON_COLUMNS::Column::compare_bool(bool x) const
+{
+  if (type_ == ColumnType::kNull)
+  {
+    return mask_t(valid_.size(), 0);
+  }
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kBool, "Expecting a bool column.");
+  return _compare(bools_.data(), Compare::kEqual,
+                  static_cast<uint8_t>(x ? 1 : 0));
+}
+
+// ----------------------------------------------------------------------------
+// Aggregations.
+
+template <typename JsonT>
+size_t REDBUD_JSON_COLUMNS::Column::count(const mask_t* mask) const
+{
+  _check_mask(mask);
+  size_t n = 0;
+  for (size_t w = 0; w < valid_.size(); ++w)
+  {
+    uint64_t bits = valid_[w] & (mask != nullptr ? (*mask)[w] : ~0ull);
+    n += std::bitset<64>(bits).count();
+  }
+  return n;
+}
+
+template <typename JsonT>
+double REDBUD_JSON_COLUMNS::Column::sum(const mask_t* mask) const
+{
+  _check_mask(mask);
+  switch (type_)
+  {
+    case ColumnType::kInt64:  return _sum(int64s_.data(), mask);
+    case ColumnType::kDouble: return _sum(doubles_.data(), mask);
+    case ColumnType::kNull:   return 0.0;
+    default:
+      REDBUD_THROW_EX_IF(true, "Expecting a number column.");
+  }
+  return 0.0;  // Ignores the warning.
+}
+
+template <typename JsonT>
+double REDBUD_JSON_COLUMNS::Column::min(const mask_t* mask) const
+{
+  REDBUD_THROW_EX_IF(count(mask) == 0, "No value is selected.");
+  if (type_ == ColumnType::kInt64)
+  {
+    return _reduce(int64s_.data(), mask,
+                   std::numeric_limits<int64_t>::max(),
+                   [](int64_t a, int64_t b) { return std::min(a, b); });
+  }
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kDouble,
+                     "Expecting a number column.");
+  return _reduce(doubles_.data(), mask,
+                 std::numeric_limits<double>::infinity(),
+                 [](double a, double b) { return std::min(a, b); });
+}
+
+template <typename JsonT>
+double REDBUD_JSON_COLUMNS::Column::max(const mask_t* mask) const
+{
+  REDBUD_THROW_EX_IF(count(mask) == 0, "No value is selected.");
+  if (type_ == ColumnType::kInt64)
+  {
+    return _reduce(int64s_.data(), mask,
+                   std::numeric_limits<int64_t>::min(),
+                   [](int64_t a, int64_t b) { return std::max(a, b); });
+  }
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kDouble,
+                     "Expecting a number column.");
+  return _reduce(doubles_.data(), mask,
+                 -std::numeric_limits<double>::infinity(),
+                 [](double a, double b) { return std::max(a, b); });
+}
+
+template <typename JsonT>
+double REDBUD_JSON_COLUMNS::Column::mean(const mask_t* mask) const
+{
+  size_t n = count(mask);
+  REDBUD_THROW_EX_IF(n == 0, "No value is selected.");
+  return sum(mask) / static_cast<double>(n);
+}
+
+// ----------------------------------------------------------------------------
+// Helper functions of Column.
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_push_null()
+{
+  switch (type_)
+  {
+    case ColumnType::kBool:   bools_.push_back(0);   break;
+    case ColumnType::kInt64:  int64s_.push_back(0);  break;
+    case ColumnType::kDouble: doubles_.push_back(0); break;
+    case ColumnType::kString: codes_.push_back(0);   break;
+    default: break;
+  }
+  _push_valid(false);
+  ++nulls_;
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_push_bool(bool b)
+{
+  _set_type(ColumnType::kBool);
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kBool, "Mixed types in a column.");
+  bools_.push_back(b ? 1 : 0);
+  _push_valid(true);
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_push_number(double d)
+{
+  // The integral values within the range of int64 are kept as int64 until
+  // a decimal appears, then the column is converted to double.
+  bool integral = std::trunc(d) == d &&
+    d >= -9223372036854775808.0 && d < 9223372036854775808.0;
+  _set_type(integral ? ColumnType::kInt64 : ColumnType::kDouble);
+  if (type_ == ColumnType::kInt64 && !integral)
+  {
+    doubles_.assign(int64s_.begin(), int64s_.end());
+    int64s_ = vector_t<int64_t>();
+    type_ = ColumnType::kDouble;
+  }
+  if (type_ == ColumnType::kInt64)
+  {
+    int64s_.push_back(static_cast<int64_t>(d));
+  }
+  else
+  {
+    REDBUD_THROW_EX_IF(type_ != ColumnType::kDouble,
+                       "Mixed types in a column.");
+    doubles_.push_back(d);
+  }
+  _push_valid(true);
+}
+
+template <typename JsonT>
+bool REDBUD_JSON_COLUMNS::Column::_push_integer(const char* s, size_t n)
+{
+  int64_t v = 0;
+  auto res = std::from_chars(s, s + n, v);
+  if (res.ec != std::errc() || res.ptr != s + n)
+  {
+    return false;
+  }
+  _set_type(ColumnType::kInt64);
+  if (type_ == ColumnType::kDouble)
+  {
+    doubles_.push_back(static_cast<double>(v));
+  }
+  else
+  {
+    REDBUD_THROW_EX_IF(type_ != ColumnType::kInt64,
+                       "Mixed types in a column.");
+    int64s_.push_back(v);
+  }
+  _push_valid(true);
+  return true;
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_push_string(const string_t& s)
+{
+  _set_type(ColumnType::kString);
+  REDBUD_THROW_EX_IF(type_ != ColumnType::kString,
+                     "Mixed types in a column.");
+  auto it = codes_of_.find(s);
+  if (it == codes_of_.end())
+  {
+    it = codes_of_.emplace(s, static_cast<uint32_t>(dictionary_.size())).first;
+    dictionary_.push_back(s);
+  }
+  codes_.push_back(it->second);
+  _push_valid(true);
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_pop()
+{
+  size_t i = size_ - 1;
+  if (is_null(i))
+  {
+    --nulls_;
+  }
+  switch (type_)
+  {
+    case ColumnType::kBool:   bools_.pop_back();   break;
+    case ColumnType::kInt64:  int64s_.pop_back();  break;
+    case ColumnType::kDouble: doubles_.pop_back(); break;
+    case ColumnType::kString: codes_.pop_back();   break;
+    default: break;
+  }
+  valid_[i / 64] &= ~(1ull << (i % 64));
+  if (i % 64 == 0)
+  {
+    valid_.pop_back();
+  }
+  size_ = i;
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_set_type(ColumnType t)
+{
+  if (type_ != ColumnType::kNull)
+  {
+    return;
+  }
+  // The previous values are all nulls.
+  type_ = t;
+  switch (t)
+  {
+    case ColumnType::kBool:   bools_.resize(size_, 0);   break;
+    case ColumnType::kInt64:  int64s_.resize(size_, 0);  break;
+    case ColumnType::kDouble: doubles_.resize(size_, 0); break;
+    case ColumnType::kString: codes_.resize(size_, 0);   break;
+    default: break;
+  }
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_push_valid(bool valid)
+{
+  if (size_ % 64 == 0)
+  {
+    valid_.push_back(0);
+  }
+  valid_.back() |= static_cast<uint64_t>(valid ? 1 : 0) << (size_ % 64);
+  ++size_;
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::Column::_check_mask(const mask_t* mask) const
+{
+  REDBUD_THROW_EX_IF(mask != nullptr && mask->size() != valid_.size(),
+                     "The mask does not match the column.");
+}
+
+template <typename JsonT>
+template <typename F>
+typename REDBUD_JSON_COLUMNS::mask_t
+REDBUD_JSON_COLUMNS::Column::_select(F f) const
+{
+  mask_t m(valid_.size(), 0);
+  for (size_t w = 0; w < valid_.size(); ++w)
+  {
+    size_t b = w * 64;
+    size_t n = std::min<size_t>(64, size_ - b);
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      bits |= static_cast<uint64_t>(f(b + i) ? 1 : 0) << i;
+    }
+    m[w] = bits & valid_[w];
+  }
+  return m;
+}
+
+template <typename JsonT>
+template <typename T, typename U>
+typename REDBUD_JSON_COLUMNS::mask_t
+REDBUD_JSON_COLUMNS::Column::_compare(const T* p, Compare op,
+                                      const U& x) const
+{
+  // Dispatches once, so that each loop is a plain comparison.
+  switch (op)
+  {
+    case Compare::kEqual:
+      return _select([p, x](size_t i) { return p[i] == x; });
+    case Compare::kNotEqual:
+      return _select([p, x](size_t i) { return p[i] != x; });
+    case Compare::kLess:
+      return _select([p, x](size_t i) { return p[i] < x; });
+    case Compare::kLessEqual:
+      return _select([p, x](size_t i) { return p[i] <= x; });
+    case Compare::kGreater:
+      return _select([p, x](size_t i) { return p[i] > x; });
+    case Compare::kGreaterEqual:
+      return _select([p, x](size_t i) { return p[i] >= x; });
+  }
+  return{};  // Ignores the warning.
+}
+
+template <typename JsonT>
+template <typename T>
+double REDBUD_JSON_COLUMNS::Column::_sum(const T* p,
+                                        const mask_t* mask) const
+{
+  double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+  for (size_t w = 0; w < valid_.size(); ++w)
+  {
+    uint64_t bits = valid_[w] & (mask != nullptr ? (*mask)[w] : ~0ull);
+    const T* q = p + w * 64;
+    if (bits == ~0ull)
+    {  // A full word, sums with four accumulators.
+      for (size_t i = 0; i < 64; i += 4)
+      {
+        s0 += static_cast<double>(q[i]);
+        s1 += static_cast<double>(q[i + 1]);
+        s2 += static_cast<double>(q[i + 2]);
+        s3 += static_cast<double>(q[i + 3]);
+      }
+    }
+    else if (bits != 0)
+    {
+      size_t n = std::min<size_t>(64, size_ - w * 64);
+      for (size_t i = 0; i < n; ++i)
+      {
+        s0 += ((bits >> i) & 1) ? static_cast<double>(q[i]) : 0.0;
+      }
+    }
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+template <typename JsonT>
+template <typename T, typename F>
+double REDBUD_JSON_COLUMNS::Column::_reduce(const T* p, const mask_t* mask,
+                                           T init, F f) const
+{
+  T r = init;
+  for (size_t w = 0; w < valid_.size(); ++w)
+  {
+    uint64_t bits = valid_[w] & (mask != nullptr ? (*mask)[w] : ~0ull);
+    const T* q = p + w * 64;
+    if (bits == ~0ull)
+    {
+      for (size_t i = 0; i < 64; ++i)
+      {
+        r = f(r, q[i]);
+      }
+    }
+    else if (bits != 0)
+    {
+      size_t n = std::min<size_t>(64, size_ - w * 64);
+      for (size_t i = 0; i < n; ++i)
+      {
+        r = ((bits >> i) & 1) ? f(r, q[i]) : r;
+      }
+    }
+  }
+  return static_cast<double>(r);
+}
+
+// ----------------------------------------------------------------------------
+// Constructor.
+
+template <typename JsonT>
+REDBUD_JSON_COLUMNS::JsonColumns(const JsonT& records)
+  :rows_(0)
+{
+  for (const auto& record : records.as_array())
+  {
+    size_t i = 0;
+    for (const auto& field : record.as_object())
+    {
+      Column& c = _field(field.first, i++);
+      const JsonT& v = field.second;
+      switch (v.type())
+      {
+        case JsonT::Type::kJsonNull:   c._push_null();               break;
+        case JsonT::Type::kJsonBool:   c._push_bool(v.as_bool());     break;
+        case JsonT::Type::kJsonNumber:
+          // The kept text of an integer is read exactly, since the double
+          // value of an integer beyond 2^53 may be rounded.
+          if (v.is_bignum() || v.is_lazy())
+          {
+            auto text = v.as_number_text();
+            if (c._push_integer(text.data(), text.size()))
+            {
+              break;
+            }
+          }
+          c._push_number(v.as_double());
+          break;
+        case JsonT::Type::kJsonString: c._push_string(v.as_string()); break;
+        default:
+          REDBUD_THROW_EX_IF(true, "Expecting a scalar value.");
+      }
+    }
+    _end_row();
+  }
+}
+
+template <typename JsonT>
+REDBUD_JSON_COLUMNS REDBUD_JSON_COLUMNS::parse(const string_t& text)
+{
+  return JsonParser<JsonT>::parse_columns(text);
+}
+
+// ----------------------------------------------------------------------------
+// Element access.
+
+template <typename JsonT>
+const typename REDBUD_JSON_COLUMNS::Column&
+REDBUD_JSON_COLUMNS::operator[](const string_t& key) const
+{
+  const Column* c = find(key);
+  REDBUD_THROW_EX_IF(c == nullptr, "No such column.");
+  return *c;
+}
+
+template <typename JsonT>
+const typename REDBUD_JSON_COLUMNS::Column*
+REDBUD_JSON_COLUMNS::find(const string_t& key) const
+{
+  auto it = index_.find(key);
+  return it == index_.end() ? nullptr : &columns_[it->second];
+}
+
+template <typename JsonT>
+typename REDBUD_JSON_COLUMNS::mask_t
+REDBUD_JSON_COLUMNS::mask_and(const mask_t& a, const mask_t& b)
+{
+  REDBUD_THROW_EX_IF(a.size() != b.size(), "The masks do not match.");
+  mask_t m(a.size(), 0);
+  for (size_t w = 0; w < a.size(); ++w)
+  {
+    m[w] = a[w] & b[w];
+  }
+  return m;
+}
+
+template <typename JsonT>
+typename REDBUD_JSON_COLUMNS::mask_t
+REDBUD_JSON_COLUMNS::mask_or(const mask_t& a, const mask_t& b)
+{
+  REDBUD_THROW_EX_IF(a.size() != b.size(), "The masks do not match.");
+  mask_t m(a.size(), 0);
+  for (size_t w = 0; w < a.size(); ++w)
+  {
+    m[w] = a[w] | b[w];
+  }
+  return m;
+}
+
+template <typename JsonT>
+size_t REDBUD_JSON_COLUMNS::mask_count(const mask_t& m)
+{
+  size_t n = 0;
+  for (uint64_t bits : m)
+  {
+    n += std::bitset<64>(bits).count();
+  }
+  return n;
+}
+
+// ----------------------------------------------------------------------------
+// Helper functions.
+
+template <typename JsonT>
+typename REDBUD_JSON_COLUMNS::Column&
+REDBUD_JSON_COLUMNS::_column(const string_t& key, size_t i)
+{
+  if (i < columns_.size() && columns_[i].name_ == key)
+  {
+    return columns_[i];
+  }
+  auto it = index_.find(key);
+  if (it != index_.end())
+  {
+    return columns_[it->second];
+  }
+  // A new key, the previous rows do not have it.
+  index_.emplace(key, columns_.size());
+  columns_.emplace_back(key, rows_);
+  return columns_.back();
+}
+
+template <typename JsonT>
+typename REDBUD_JSON_COLUMNS::Column&
+REDBUD_JSON_COLUMNS::_field(const string_t& key, size_t i)
+{
+  Column& c = _column(key, i);
+  if (c.size_ > rows_)
+  {  // A repeated key, the last value wins like JsonT does.
+    c._pop();
+  }
+  return c;
+}
+
+template <typename JsonT>
+void REDBUD_JSON_COLUMNS::_end_row()
+{
+  ++rows_;
+  for (auto& c : columns_)
+  {
+    if (c.size_ < rows_)
+    {
+      c._push_null();
+    }
+  }
+}
+
+#undef REDBUD_JSON_COLUMNS
+
+} // namespace json
+} // namespace parser
+} // namespace redbud
+#endif // !ALINSHANS_REDBUD_PARSER_JSON_COLUMNS_H_
@@ -0,0 +1,400 @@
+// ============================================================================
+// Copyright (c) 2017 Alinshans. All rights reserved.
+// Licensed under the MIT License. See LICENSE for details.
+//
+// Header File : redbud/parser/json_literal.h
+//
+// This file contains a JsonLiteral class, which validates a JSON text at
+// compile time, and the REDBUD_JSON macro and the _json literal.
+// ============================================================================
+
+#ifndef ALINSHANS_REDBUD_PARSER_JSON_LITERAL_H_
+#define ALINSHANS_REDBUD_PARSER_JSON_LITERAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "json.h"
+
+namespace redbud
+{
+namespace parser
+{
+namespace json
+{
+
+// ============================================================================
+// JsonLiteral class
+//
+// This class has a constexpr validator that follows the rules of the
+// parser, so that a JSON text accepted by it never fails Json::parse.
+// The numbers are checked by their syntax and their decimal exponent, a
+// number may be rejected if it is close to the range of normal double.
+//
+// Usually it is used by REDBUD_JSON, which validates a JSON literal at
+// compile time and parses it only once:
+//   const Json& defaults = REDBUD_JSON(R"({"port":8080,"hosts":[]})");
+//   Json config = REDBUD_JSON_COPY(R"({"port":8080,"hosts":[]})");
+//   static_assert(JsonLiteral::valid("[1, 2, 3]"), "");
+class JsonLiteral
+{
+
+ public:
+
+  // True if s[0, n) is a JSON text, the whitespaces around it are allowed.
+  static constexpr bool valid(const char* s, size_t n)
+  {
+    size_t p = _value(s, n, 0);
+    return p != npos && _space(s, n, p) == n;
+  }
+
+  template <size_t N>
+  static constexpr bool valid(const char (&s)[N])
+  {
+    return valid(s, N - 1);
+  }
+
+  // Returns a copy of j which shares no array or object with it, so that
+  // modifying the copy never changes j. The scalars are still shared,
+  // since assigning to a Json rebinds it rather than modifies the value.
+  static Json clone(const Json& j)
+  {
+    if (j.is_packed())
+    {
+      auto v = j.as_numbers();
+      return Json(Json::number_array_t(v.begin(), v.end()));
+    }
+    if (j.is_array())
+    {
+      Json::array_t a;
+      a.reserve(j.size());
+      for (auto& e : j.as_array())
+      {
+        a.push_back(clone(e));
+      }
+      return Json(std::move(a));
+    }
+    if (j.is_object())
+    {
+      Json::object_t o;
+      for (auto& e : j.as_object())
+      {
+        o.emplace_hint(o.end(), e.first, clone(e.second));
+      }
+      return Json(std::move(o));
+    }
+    return j;
+  }
+
+ private:
+
+  // Each of the following functions checks a value from s[p], and returns
+  // the position after it, or npos if it is invalid.
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  static constexpr bool _digit(char ch)
+  {
+    return ch >= '0' && ch <= '9';
+  }
+
+  static constexpr int _xdigit(char ch)
+  {
+    return ch >= '0' && ch <= '9' ? ch - '0'
+      : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10
+      : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10
+      : -1;
+  }
+
+  static constexpr size_t _space(const char* s, size_t n, size_t p)
+  {
+    while (p < n &&
+           (s[p] == ' ' || s[p] == '\t' || s[p] == '\n' || s[p] == '\r'))
+    {
+      ++p;
+    }
+    return p;
+  }
+
+  static constexpr size_t _value(const char* s, size_t n, size_t p)
+  {
+    p = _space(s, n, p);
+    if (p >= n)
+    {
+      return npos;
+    }
+    switch (s[p])
+    {
+      case 'n':  return _word(s, n, p, "null");
+      case 't':  return _word(s, n, p, "true");
+      case 'f':  return _word(s, n, p, "false");
+      case '\"': return _string(s, n, p);
+      case '[':  return _array(s, n, p);
+      case '{':  return _object(s, n, p);
+      default:   return _number(s, n, p);
+    }
+  }
+
+  static constexpr size_t _word(const char* s, size_t n, size_t p,
+                                const char* w)
+  {
+    for (; *w != '\0'; ++w, ++p)
+    {
+      if (p >= n || s[p] != *w)
+      {
+        return npos;
+      }
+    }
+    return p;
+  }
+
+  static constexpr size_t _number(const char* s, size_t n, size_t p)
+  {
+    if (p < n && s[p] == '-')
+    {
+      ++p;
+    }
+    if (p >= n || !_digit(s[p]))
+    {
+      return npos;
+    }
+    // The decimal exponent of the first significant digit, the value is
+    // zero if there is no such digit.
+    int64_t e10 = 0;
+    bool nonzero = false;
+    if (s[p] == '0')
+    {
+      ++p;
+    }
+    else
+    {
+      nonzero = true;
+      for (e10 = -1; p < n && _digit(s[p]); ++p)
+      {
+        ++e10;
+      }
+    }
+    if (p < n && s[p] == '.')
+    {
+      ++p;
+      if (p >= n || !_digit(s[p]))
+      {
+        return npos;
+      }
+      for (int64_t z = -1; p < n && _digit(s[p]); ++p, --z)
+      {
+        if (!nonzero && s[p] != '0')
+        {
+          nonzero = true;
+          e10 = z;
+        }
+      }
+    }
+    if (p < n && (s[p] == 'e' || s[p] == 'E'))
+    {
+      ++p;
+      bool negative = false;
+      if (p < n && (s[p] == '+' || s[p] == '-'))
+      {
+        negative = s[p++] == '-';
+      }
+      if (p >= n || !_digit(s[p]))
+      {
+        return npos;
+      }
+      int64_t exp = 0;
+      for (; p < n && _digit(s[p]); ++p)
+      {
+        exp = exp < 100000 ? exp * 10 + (s[p] - '0') : exp;
+      }
+      e10 += negative ? -exp : exp;
+    }
+    // Json::parse rejects the numbers out of the range of double, which is
+    // at most 1.7976931348623157e308, so all the numbers of 1e308 or above
+    // are rejected here.
+    return nonzero && (e10 >= 308 || e10 < -307) ? npos : p;
+  }
+
+  static constexpr size_t _hex4(const char* s, size_t n, size_t p,
+                                uint32_t& u)
+  {
+    for (int i = 0; i < 4; ++i, ++p)
+    {
+      if (p >= n || _xdigit(s[p]) < 0)
+      {
+        return npos;
+      }
+      u = (u << 4) | static_cast<uint32_t>(_xdigit(s[p]));
+    }
+    return p;
+  }
+
+  static constexpr size_t _string(const char* s, size_t n, size_t p)
+  {
+    for (++p; p < n; )
+    {
+      char ch = s[p];
+      if (ch == '\"')
+      {
+        return p + 1;
+      }
+      if (static_cast<unsigned char>(ch) < 0x20)
+      {
+        return npos;
+      }
+      if (ch != '\\')
+      {
+        ++p;
+        continue;
+      }
+      if (++p >= n)
+      {
+        return npos;
+      }
+      switch (s[p])
+      {
+        case '\"': case '\\': case '/': case 'b':
+        case 'f':  case 'n':  case 'r': case 't':
+          ++p;
+          break;
+        case 'u':
+        {
+          uint32_t u = 0;
+          p = _hex4(s, n, p + 1, u);
+          if (p == npos)
+          {
+            return npos;
+          }
+          if (u >= 0xD800 && u <= 0xDBFF)
+          {  // A high surrogate must be followed by a low surrogate.
+            uint32_t u2 = 0;
+            if (p + 1 >= n || s[p] != '\\' || s[p + 1] != 'u')
+            {
+              return npos;
+            }
+            p = _hex4(s, n, p + 2, u2);
+            if (p == npos || u2 < 0xDC00 || u2 > 0xDFFF)
+            {
+              return npos;
+            }
+          }
+          break;
+        }
+        default:
+          return npos;
+      }
+    }
+    return npos;
+  }
+
+  static constexpr size_t _array(const char* s, size_t n, size_t p)
+  {
+    p = _space(s, n, p + 1);
+    if (p < n && s[p] == ']')
+    {
+      return p + 1;
+    }
+    while (p != npos)
+    {
+      p = _value(s, n, p);
+      if (p == npos)
+      {
+        return npos;
+      }
+      p = _space(s, n, p);
+      if (p < n && s[p] == ']')
+      {
+        return p + 1;
+      }
+      p = p < n && s[p] == ',' ? p + 1 : npos;
+    }
+    return npos;
+  }
+
+  static constexpr size_t _object(const char* s, size_t n, size_t p)
+  {
+    p = _space(s, n, p + 1);
+    if (p < n && s[p] == '}')
+    {
+      return p + 1;
+    }
+    while (p != npos)
+    {
+      p = _space(s, n, p);
+      if (p >= n || s[p] != '\"')
+      {
+        return npos;
+      }
+      p = _space(s, n, _string(s, n, p));
+      if (p >= n || s[p] != ':')
+      {
+        return npos;
+      }
+      p = _value(s, n, p + 1);
+      if (p == npos)
+      {
+        return npos;
+      }
+      p = _space(s, n, p);
+      if (p < n && s[p] == '}')
+      {
+        return p + 1;
+      }
+      p = p < n && s[p] == ',' ? p + 1 : npos;
+    }
+    return npos;
+  }
+
+};
+
+// ============================================================================
+// _json literal
+//
+// Parses a JSON text at run time, e.g.:
+//   using namespace redbud::parser::json::literals;
+//   Json j = "[1, 2, 3]"_json;
+// For a fixed JSON text, prefer REDBUD_JSON, which validates the text at
+// compile time and parses it only once.
+
+namespace literals
+{
+
+inline Json operator""_json(const char* s, size_t n)
+{
+  return Json::parse(Json::string_t(s, n));
+}
+
+} // namespace literals
+
+} // namespace json
+} // namespace parser
+} // namespace redbud
+
+// ============================================================================
+// REDBUD_JSON(text)
+//
+// Validates a JSON literal at compile time, a malformed one fails to build.
+// The text is parsed on the first evaluation only, each evaluation returns
+// a reference to the same static Json without allocating. The value is
+// read-only: a copy of a Json shares its arrays and objects, so modifying a
+// copy of it changes the value for all the other evaluations. Use
+// REDBUD_JSON_COPY to get a value that may be modified.
+#define REDBUD_JSON(text)                                                 \
+  ([]() -> const ::redbud::parser::json::Json& {                          \
+    static_assert(::redbud::parser::json::JsonLiteral::valid(text),       \
+                  "Invalid JSON literal.");                               \
+    static const ::redbud::parser::json::Json json =                      \
+      ::redbud::parser::json::Json::parse(text);                          \
+    return json;                                                          \
+  }())
+
+// ============================================================================
+// REDBUD_JSON_COPY(text)
+//
+// Like REDBUD_JSON, but returns a JsonLiteral::clone of the static Json,
+// which allocates its arrays and objects again on each evaluation and may
+// be modified freely.
+#define REDBUD_JSON_COPY(text)                                            \
+  (::redbud::parser::json::JsonLiteral::clone(REDBUD_JSON(text)))
+
+#endif // !ALINSHANS_REDBUD_PARSER_JSON_LITERAL_H_
@@ -10,8 +10,18 @@
 #ifndef ALINSHANS_REDBUD_PARSER_JSON_PARSER_H_
 #define ALINSHANS_REDBUD_PARSER_JSON_PARSER_H_
 
-#include "json.h"
+#include <cstdint>
+#include <cstdlib>      // strtod
+#include <cerrno>       // errno, ERANGE
+
+#include <memory>       // shared_ptr, make_shared
+#include <string>       // string
+#include <type_traits>  // is_same
+#include <utility>      // move
+
 #include "reader.h"
+#include "tokenizer.h"
+#include "../exception.h"
 
 namespace redbud
 {
@@ -20,46 +30,720 @@ namespace parser
 namespace json
 {
 
+// ============================================================================
+// Forward declaration
+
+template <typename JsonT>
+class JsonColumns;
+
+// ============================================================================
+// JsonTextView
+//
+// A piece of the JSON text kept by a lazy node, see ParseOptions of
+// BasicJson. The nodes share the whole text, so the view stays valid after
+// the parser returns.
+struct JsonTextView
+{
+  std::shared_ptr<const std::string> text;
+  size_t                             pos;
+  size_t                             len;
+
+  const char* data() const { return text->data() + pos; }
+};
+
 // ============================================================================
 // Json Parser class
+//
+// This class parses a JSON text into a JsonT, which is an instance of
+// BasicJson.
+template <typename JsonT>
 class JsonParser
 {
 
+  // --------------------------------------------------------------------------
+  // Type definition.
+ public:
+  using string_t       = typename JsonT::string_t;
+  using array_t        = typename JsonT::array_t;
+  using object_t       = typename JsonT::object_t;
+  using number_array_t = typename JsonT::number_array_t;
+  using NumberPolicy   = typename JsonT::NumberPolicy;
+  using ParseOptions   = typename JsonT::ParseOptions;
+
   // --------------------------------------------------------------------------
   // Static function.
  public:
-  static Json parse(const std::string& s);
-  static Json parse(std::string&& s);
+  static JsonT parse(const string_t& s, ParseOptions options = ParseOptions());
+  static JsonT parse(string_t&& s, ParseOptions options = ParseOptions());
+
+  // Parses a JSON array of objects into columns, see JsonColumns.
+  static JsonColumns<JsonT> parse_columns(const string_t& s);
+
+  // Decodes the content of a JSON string which is kept by a lazy node,
+  // the content is the text between the quotes.
+  static string_t decode_string(const char* s, size_t n);
 
   // --------------------------------------------------------------------------
   // Copy constructor.
  public:
-  JsonParser(const std::string& s);
-  JsonParser(std::string&& s);
+  JsonParser(const std::string& s, ParseOptions options = ParseOptions());
+  JsonParser(std::string&& s, ParseOptions options = ParseOptions());
 
   // --------------------------------------------------------------------------
   // Helper functions.
  private:
 
+  // Parses the whole text, in lazy mode, hands the text over to the nodes.
+  JsonT       parse_text();
+
   // Parses the corresponding JSON type.
-  Json        parse_json();
-  Json        parse_literal(const char* s, Json&& j);
-  Json        parse_number();
-  std::string parse_string();
-  Json        parse_array();
-  Json        parse_object();
+  JsonT       parse_json();
+  JsonT       parse_literal(const char* s, JsonT&& j);
+  JsonT       parse_number();
+  double      parse_double();
+  string_t    parse_string();
+  JsonT       parse_lazy_string();
+
+  // Parses the records into columns, the values must be scalars.
+  void        parse_records(JsonColumns<JsonT>& table);
+
+  // Validates a number and returns its beginning, then converts it.
+  size_t      scan_number();
+  double      to_double(size_t p, size_t n);
+  JsonT       parse_array();
+  JsonT       parse_object();
 
   // Parses unicode.
   void        parse_hex4(uint32_t& u);
-  std::string parse_utf8();
+  void        parse_utf8(string_t& str);
+
+  // True if the digits [p, p + n) are an integer greater than 2^53, which
+  // can not be represented exactly by double.
+  bool        inexact_integer(size_t p, size_t n) const;
 
   // --------------------------------------------------------------------------
   // Private member data.
  private:
-  Reader r;
+  Reader       r;
+  NumberPolicy policy_;
+
+  // The text shared by the lazy nodes, nullptr if it is not in lazy mode.
+  // It is filled when the parsing finishes.
+  std::shared_ptr<std::string> text_;
+
+  // Set by scan_number(), whether the last number should be kept in its
+  // text by the policy.
+  bool         keep_text_;
 
 };
 
+// ============================================================================
+// Implementation of JsonParser.
+
+// ----------------------------------------------------------------------------
+// Static function.
+
+// The Reader only reads std::string, other string types are copied into it.
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse(const string_t& s, ParseOptions options)
+{
+  if constexpr (std::is_same_v<string_t, std::string>)
+  {
+    JsonParser jp(s, options);
+    return jp.parse_text();
+  }
+  else
+  {
+    JsonParser jp(std::string(s.data(), s.size()), options);
+    return jp.parse_text();
+  }
+}
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse(string_t&& s, ParseOptions options)
+{
+  if constexpr (std::is_same_v<string_t, std::string>)
+  {
+    JsonParser jp(std::move(s), options);
+    return jp.parse_text();
+  }
+  else
+  {
+    JsonParser jp(std::string(s.data(), s.size()), options);
+    return jp.parse_text();
+  }
+}
+
+template <typename JsonT>
+JsonColumns<JsonT> JsonParser<JsonT>::parse_columns(const string_t& s)
+{
+  JsonColumns<JsonT> table;
+  if constexpr (std::is_same_v<string_t, std::string>)
+  {
+    JsonParser jp(s);
+    jp.parse_records(table);
+  }
+  else
+  {
+    JsonParser jp(std::string(s.data(), s.size()));
+    jp.parse_records(table);
+  }
+  return table;
+}
+
+template <typename JsonT>
+typename JsonParser<JsonT>::string_t
+JsonParser<JsonT>::decode_string(const char* s, size_t n)
+{
+  std::string text;
+  text.reserve(n + 2);
+  text.push_back('\"');
+  text.append(s, n);
+  text.push_back('\"');
+  JsonParser jp(std::move(text));
+  return jp.parse_string();
+}
+
+// ----------------------------------------------------------------------------
+// Copy constructor.
+
+template <typename JsonT>
+JsonParser<JsonT>::JsonParser(const std::string& s, ParseOptions options)
+  :r(s), policy_(options.number),
+   text_(options.lazy ? std::make_shared<std::string>() : nullptr),
+   keep_text_(false)
+{
+}
+
+template <typename JsonT>
+JsonParser<JsonT>::JsonParser(std::string&& s, ParseOptions options)
+  :r(std::move(s)), policy_(options.number),
+   text_(options.lazy ? std::make_shared<std::string>() : nullptr),
+   keep_text_(false)
+{
+}
+
+// ----------------------------------------------------------------------------
+// Parses process.
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse_text()
+{
+  JsonT j = parse_json();
+  if (text_ != nullptr)
+  {  // The offsets of the lazy nodes are still valid in the moved text.
+    *text_ = r.release();
+  }
+  return j;
+}
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse_json()
+{
+  r.skipspace();
+  switch (r.now())
+  {
+    case 'n': return parse_literal("null", nullptr);
+    case 't': return parse_literal("true", true);
+    case 'f': return parse_literal("false", false);
+    case '\"':
+      if (text_ != nullptr)
+      {
+        return parse_lazy_string();
+      }
+      return parse_string();
+    case '[': return parse_array();
+    case '{': return parse_object();
+    case '\0':
+      REDBUD_THROW_PEX_IF(r.now() == '\0', "Valid end of JSON.", "", r.getp());
+
+    default:
+      return parse_number();
+  }
+}
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse_literal(const char* s, JsonT&& j)
+{
+  r.skipspace();
+  r.expect(s);
+  return j;
+}
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse_number()
+{
+  size_t p = scan_number();
+  size_t n = r.getp() - p;
+  if (text_ != nullptr && !keep_text_)
+  {
+    return JsonT::_make_lazy_number(JsonTextView{ text_, p, n });
+  }
+  double d = to_double(p, n);
+  if (keep_text_)
+  {
+    std::string text = r.getsub(p, n);
+    return JsonT::_make_bignum(string_t(text.data(), text.size()), d);
+  }
+  return d;
+}
+
+template <typename JsonT>
+double JsonParser<JsonT>::parse_double()
+{
+  size_t p = scan_number();
+  return to_double(p, r.getp() - p);
+}
+
+template <typename JsonT>
+size_t JsonParser<JsonT>::scan_number()
+{
+#define EXP_AND_SKIP_NUM                      \
+  REDBUD_THROW_PEX_IF(!Token::digit(r.now()), \
+                   "digits 0 - 9",            \
+                   std::to_string(r.now()),   \
+                   r.getp());                 \
+  do { r.to(1); } while (Token::digit(r.now()))
+
+  r.skipspace();
+  size_t p = r.getp();
+  r.skip('-');
+  size_t int_begin = r.getp();
+  if (r.now() == '0')
+  {
+    r.to(1);
+  }
+  else
+  {
+    REDBUD_THROW_PEX_IF(!Token::digit(r.now()),
+                        "Valid JSON value.",
+                        std::to_string(r.now()),
+                        r.getp());
+    do { r.to(1); } while (Token::digit(r.now()));
+  }
+  size_t int_digits = r.getp() - int_begin;
+  bool integer = true;
+  if (r.match('.'))
+  {
+    integer = false;
+    EXP_AND_SKIP_NUM;
+  }
+  if (r.now() == 'e' || r.now() == 'E')
+  {
+    integer = false;
+    r.to(1);
+    if (r.now() == '+' || r.now() == '-')
+    {
+      r.to(1);
+    }
+    EXP_AND_SKIP_NUM;
+  }
+  // Only the integers with 16 or more digits may be inexact.
+  keep_text_ = integer
+    ? policy_ != NumberPolicy::kDouble && int_digits >= 16 &&
+      inexact_integer(int_begin, int_digits)
+    : policy_ == NumberPolicy::kText;
+  return p;
+
+#undef EXP_AND_SKIP_NUM
+}
+
+template <typename JsonT>
+double JsonParser<JsonT>::to_double(size_t p, size_t n)
+{
+  errno = 0;
+  double d = strtod(r.getsub(p, n).c_str(), nullptr);
+  REDBUD_THROW_PEX_IF(errno == ERANGE && !keep_text_,
+                      "Valid numbers", std::to_string(d), p);
+  return d;
+}
+
+template <typename JsonT>
+typename JsonParser<JsonT>::string_t
+JsonParser<JsonT>::parse_string()
+{
+#define PUTC(ch)                        \
+  str.push_back(static_cast<char>(ch)); \
+  r.to(1);                              \
+  continue
+
+  r.skipspace();
+  r.expect('\"');
+  if (r.match('\"'))
+  {
+    return{};
+  }
+
+  string_t str;
+  while (!r.eof())
+  {
+    if (r.now() == '\"')
+    {  // End of string.
+      r.to(1);
+      return str;
+    }
+    else if (r.now() == '\\')
+    {  // Escaped characters.
+      r.to(1);
+      switch (r.now())
+      {
+        case '\"': PUTC('\"');
+        case '\\': PUTC('\\');
+        case '/':  PUTC('/');
+        case 'b':  PUTC('\b');
+        case 'f':  PUTC('\f');
+        case 'n':  PUTC('\n');
+        case 'r':  PUTC('\r');
+        case 't':  PUTC('\t');
+        case 'u':
+          r.to(-1); // Parses `\uXXXX`.
+          parse_utf8(str);
+          continue;
+        default:    // Parses fail.
+          size_t p = r.getp();
+          bool InvalidEscapedCharacters = true;
+          REDBUD_THROW_PEX_IF(InvalidEscapedCharacters,
+                              "Valid escaped characters.",
+                              r.getsub(p - 1, 2),
+                              p);
+      }
+    }
+    else
+    { // Other characters.
+      PUTC(r.now());
+    }
+  }
+  REDBUD_THROW_PEX_IF(r.eof(),
+                      "'\"' at the end of the JSON string",
+                      "",
+                      r.getp());
+  return{};  // Ignores the warning.
+
+#undef PUTC
+}
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse_lazy_string()
+{
+  r.skipspace();
+  r.expect('\"');
+  size_t p = r.getp();
+  bool escaped = false;
+  while (!r.eof())
+  {
+    if (r.now() == '\"')
+    {  // End of string, only the escaped string is decoded lazily.
+      size_t n = r.getp() - p;
+      r.to(1);
+      if (escaped)
+      {
+        return JsonT::_make_lazy_string(JsonTextView{ text_, p, n });
+      }
+      return string_t(r.gets().data() + p, n);
+    }
+    else if (r.now() == '\\')
+    {  // Validates the escaped characters, the surrogate pairs are checked
+       // when the string is decoded.
+      escaped = true;
+      switch (r.next())
+      {
+        case '\"': case '\\': case '/': case 'b':
+        case 'f':  case 'n':  case 'r': case 't':
+          r.to(2);
+          continue;
+        case 'u':
+        {
+          uint32_t u = 0;
+          parse_hex4(u);
+          continue;
+        }
+        default:
+          size_t q = r.getp();
+          bool InvalidEscapedCharacters = true;
+          REDBUD_THROW_PEX_IF(InvalidEscapedCharacters,
+                              "Valid escaped characters.",
+                              r.getsub(q, 2),
+                              q + 1);
+      }
+    }
+    else
+    {
+      r.to(1);
+    }
+  }
+  REDBUD_THROW_PEX_IF(r.eof(),
+                      "'\"' at the end of the JSON string",
+                      "",
+                      r.getp());
+  return{};  // Ignores the warning.
+}
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse_array()
+{
+  r.skipspace();
+  r.expect('[');
+  r.skipspace();
+  array_t arr;
+  if (r.match(']'))
+  {
+    return arr;
+  }
+
+  // Packs the leading numbers into a contiguous buffer, if all the elements
+  // are numbers, returns a packed array. Otherwise moves them into arr and
+  // parses the rest as usual. In lazy mode, the numbers are kept in their
+  // text instead.
+  if (text_ == nullptr && (r.now() == '-' || Token::digit(r.now())))
+  {
+    number_array_t numbers;
+    for (;;)
+    {
+      size_t p = r.getp();
+      double d = parse_double();
+      if (keep_text_)
+      {  // Goes back and parses it again as a bignum.
+        r.to(-static_cast<int32_t>(r.getp() - p));
+        break;
+      }
+      numbers.push_back(d);
+      r.skipspace();
+      if (r.now() == ']')
+      {
+        r.to(1);
+        return numbers;
+      }
+      REDBUD_THROW_PEX_IF(r.now() != ',',
+                          " ',' or ']'",
+                          std::string(1, r.now()),
+                          r.getp());
+      r.to(1);
+      r.skipspace();
+      if (r.now() != '-' && !Token::digit(r.now()))
+      {
+        break;
+      }
+    }
+    for (double d : numbers)
+    {
+      arr.push_back(d);
+    }
+  }
+
+  while (!r.eof())
+  {
+    arr.push_back(parse_json());
+    r.skipspace();
+    if (r.now() == ']')
+    {
+      r.to(1);
+      return arr;
+    }
+    else if (r.now() == ',')
+    {
+      r.to(1);
+      continue;
+    }
+    else
+    {
+      REDBUD_THROW_PEX_IF(r.now() != ',' && r.now() != ']',
+                          " ',' or ']'",
+                          std::string(1, r.now()),
+                          r.getp());
+    }
+  }
+  REDBUD_THROW_PEX_IF(r.eof(),
+                      " ']' at end of the JSON array.",
+                      "",
+                      r.getp());
+  return{};  // Ignores the warning.
+}
+
+template <typename JsonT>
+JsonT JsonParser<JsonT>::parse_object()
+{
+  r.skipspace();
+  r.expect('{');
+  r.skipspace();
+  object_t obj;
+  if (r.match('}'))
+  {
+    return obj;
+  }
+
+  while (!r.eof())
+  {
+    auto key = parse_string();
+    r.skipspace();
+    r.expect(':');
+    obj[key] = parse_json();
+    r.skipspace();
+    if (r.now() == '}')
+    {
+      r.to(1);
+      return obj;
+    }
+    else if (r.now() == ',')
+    {
+      r.to(1);
+      continue;
+    }
+    else
+    {
+      REDBUD_THROW_PEX_IF(r.now() != ',' && r.now() != '}',
+                          "',' or '}'",
+                          std::to_string(r.now()),
+                          r.getp());
+    }
+  }
+  REDBUD_THROW_PEX_IF(r.eof(),
+                      " '}' at end of the JSON object.",
+                      "",
+                      r.getp());
+  return{};  // Ignores the warning.
+}
+
+template <typename JsonT>
+void JsonParser<JsonT>::parse_records(JsonColumns<JsonT>& table)
+{
+  r.skipspace();
+  r.expect('[');
+  r.skipspace();
+  if (r.match(']'))
+  {
+    return;
+  }
+
+  for (;;)
+  {
+    r.skipspace();
+    r.expect('{');
+    r.skipspace();
+    for (size_t i = 0; !r.match('}'); ++i)
+    {
+      auto& column = table._field(parse_string(), i);
+      r.skipspace();
+      r.expect(':');
+      r.skipspace();
+      switch (r.now())
+      {
+        case 'n': r.expect("null");  column._push_null();      break;
+        case 't': r.expect("true");  column._push_bool(true);  break;
+        case 'f': r.expect("false"); column._push_bool(false); break;
+        case '\"':
+          column._push_string(parse_string());
+          break;
+        case '[':
+        case '{':
+          REDBUD_THROW_PEX_IF(true, "Scalar value.",
+                              std::string(1, r.now()), r.getp());
+        default:
+        {  // The integers are read exactly, the others as double.
+          size_t p = scan_number();
+          size_t n = r.getp() - p;
+          if (!column._push_integer(r.gets().data() + p, n))
+          {
+            column._push_number(to_double(p, n));
+          }
+        }
+      }
+      r.skipspace();
+      if (r.now() == ',')
+      {  // Expects the next key.
+        r.to(1);
+        r.skipspace();
+        REDBUD_THROW_PEX_IF(r.now() != '\"', "'\"'",
+                            std::string(1, r.now()), r.getp());
+        continue;
+      }
+      REDBUD_THROW_PEX_IF(r.now() != '}', "',' or '}'",
+                          std::string(1, r.now()), r.getp());
+    }
+    table._end_row();
+    r.skipspace();
+    if (r.match(']'))
+    {
+      return;
+    }
+    REDBUD_THROW_PEX_IF(r.now() != ',', " ',' or ']'",
+                        std::string(1, r.now()), r.getp());
+    r.to(1);
+  }
+}
+
+template <typename JsonT>
+bool JsonParser<JsonT>::inexact_integer(size_t p, size_t n) const
+{
+  if (n != 16)
+  {
+    return n > 16;
+  }
+  return r.getsub(p, n) > "9007199254740992";
+}
+
+template <typename JsonT>
+void JsonParser<JsonT>::parse_hex4(uint32_t& u)
+{
+  size_t p = r.getp();
+  REDBUD_THROW_PEX_IF(!r.match("\\u"), "\\uXXXX", r.getsub(p, 6), p);
+  for (int i = 0; i < 4; ++i, r.to(1))
+  {
+    REDBUD_THROW_PEX_IF(!Token::xdigit(r.now()), "\\uXXXX", r.getsub(p, 6), p);
+    u <<= 4;
+    u |= Token::to_digit(r.now());
+  }
+}
+
+template <typename JsonT>
+void JsonParser<JsonT>::parse_utf8(string_t& str)
+{
+#define PUTC(ch) str.push_back(static_cast<char>(ch))
+
+  uint32_t u = 0;
+  uint32_t u2 = 0;
+  size_t p = r.getp();
+  parse_hex4(u);
+  if (u >= 0xD800 && u <= 0xDBFF)  // surrogate pair
+  {
+    parse_hex4(u2);
+    REDBUD_THROW_PEX_IF(u2 < 0xDC00 || u2 > 0xDFFF,
+                        "low surrogate range from U+DC00 to U+DFFF",
+                        r.getsub(p + 6, 6),
+                        p + 6);
+    u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+  }
+
+  if (u <= 0x7F)
+  {
+    PUTC(u & 0xFF);
+  }
+  else if (u <= 0x7FF)
+  {
+    PUTC(0xC0 | ((u >> 6) & 0xFF));
+    PUTC(0x80 | (u & 0x3F));
+  }
+  else if (u <= 0xFFFF)
+  {
+    PUTC(0xE0 | ((u >> 12) & 0xFF));
+    PUTC(0x80 | ((u >> 6) & 0x3F));
+    PUTC(0x80 | (u & 0x3F));
+  }
+  else
+  {
+    REDBUD_THROW_PEX_IF(u > 0x10FFFF,
+                        "Valid UTF-8 encode range.",
+                        r.getsub(p, 12),
+                        p);
+    PUTC(0xF0 | ((u >> 18) & 0xFF));
+    PUTC(0x80 | ((u >> 12) & 0x3F));
+    PUTC(0x80 | ((u >> 6) & 0x3F));
+    PUTC(0x80 | (u & 0x3F));
+  }
+
+#undef PUTC
+}
+
 } // namespace json
 } // namespace parser
 } // namespace redbud
@@ -0,0 +1,121 @@
+// ============================================================================
+// Copyright (c) 2017 Alinshans. All rights reserved.
+// Licensed under the MIT License. See LICENSE for details.
+//
+// Source File : redbud/parser/json_snapshot.cc
+//
+// This file contains the implementation of JsonSnapshot class.
+// ============================================================================
+
+#include "json_snapshot.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>   // yield
+
+#include "../exception.h"
+
+namespace redbud
+{
+namespace parser
+{
+namespace json
+{
+
+// ----------------------------------------------------------------------------
+// Constructor / Destructor
+
+JsonSnapshot::JsonSnapshot(Json json, size_t max_readers)
+  :current_(new Json(std::move(json))),
+   epoch_(1),
+   slots_(new ReaderSlot[max_readers]),
+   max_readers_(max_readers)
+{
+}
+
+JsonSnapshot::~JsonSnapshot()
+{
+  for (auto& p : retired_)
+  {
+    delete p.second;
+  }
+  delete current_.load();
+}
+
+// ----------------------------------------------------------------------------
+// Member functions.
+
+JsonSnapshot::Reader JsonSnapshot::reader()
+{
+  for (size_t i = 0; i < max_readers_; ++i)
+  {
+    if (!slots_[i].used.load(std::memory_order_relaxed) &&
+        !slots_[i].used.exchange(true, std::memory_order_acquire))
+    {
+      slots_[i].depth = 0;
+      return Reader(this, &slots_[i]);
+    }
+  }
+  bool no_free_slot = true;
+  REDBUD_THROW_EX_IF(no_free_slot, "Too many readers.");
+  return Reader(this, nullptr);  // Ignores the warning.
+}
+
+void JsonSnapshot::publish(Json json)
+{
+  Json* next = new Json(std::move(json));
+  std::lock_guard<std::mutex> lock(mutex_);
+  Json* prev = current_.exchange(next);
+  // A reader which records this epoch or a later one must see next.
+  uint64_t epoch = epoch_.fetch_add(1) + 1;
+  retired_.emplace_back(epoch, prev);
+  // Pairs with the fence in Reader::lock().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  _reclaim();
+}
+
+void JsonSnapshot::synchronize()
+{
+  for (;;)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      _reclaim();
+      if (retired_.empty())
+      {
+        return;
+      }
+    }
+    std::this_thread::yield();
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Helper functions.
+
+void JsonSnapshot::_reclaim()
+{
+  // The oldest epoch that is still being read.
+  uint64_t oldest = std::numeric_limits<uint64_t>::max();
+  for (size_t i = 0; i < max_readers_; ++i)
+  {
+    uint64_t e = slots_[i].epoch.load(std::memory_order_acquire);
+    if (e != 0 && e < oldest)
+    {
+      oldest = e;
+    }
+  }
+  auto last = std::partition(retired_.begin(), retired_.end(),
+                             [oldest](const std::pair<uint64_t, Json*>& p) {
+    return p.first > oldest;
+  });
+  for (auto it = last; it != retired_.end(); ++it)
+  {
+    delete it->second;
+  }
+  retired_.erase(last, retired_.end());
+}
+
+} // namespace json
+} // namespace parser
+} // namespace redbud
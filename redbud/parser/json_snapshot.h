@@ -0,0 +1,203 @@
+// ============================================================================
+// Copyright (c) 2017 Alinshans. All rights reserved.
+// Licensed under the MIT License. See LICENSE for details.
+//
+// Header File : redbud/parser/json_snapshot.h
+//
+// This file contains a JsonSnapshot class, which shares a read-mostly Json
+// between threads, like the read-copy-update (RCU) mechanism.
+// ============================================================================
+
+#ifndef ALINSHANS_REDBUD_PARSER_JSON_SNAPSHOT_H_
+#define ALINSHANS_REDBUD_PARSER_JSON_SNAPSHOT_H_
+
+#include <cstdint>
+
+#include <atomic>            // atomic, atomic_thread_fence
+#include <memory>            // unique_ptr
+#include <mutex>             // mutex
+#include <utility>           // pair
+#include <vector>            // vector
+
+#include "json.h"
+#include "../noncopyable.h"
+
+namespace redbud
+{
+namespace parser
+{
+namespace json
+{
+
+// ============================================================================
+// JsonSnapshot class
+//
+// This class holds the latest version of a Json which is read by many
+// threads and replaced by a writer from time to time. The readers get a
+// consistent version without copying the Json, so there is no atomic
+// read-modify-write on the reference count or on any shared cache line,
+// and the throughput of readers scales with the cores.
+//
+// The memory is reclaimed by epochs: each reader owns a slot, and records
+// the global epoch in its own slot while it is reading. An old version is
+// deleted only after every reader has left the epoch it was retired in.
+//
+// Example:
+//   JsonSnapshot config(Json::parse(text));
+//
+//   // Reader threads, registers once and reads many times.
+//   auto reader = config.reader();
+//   {
+//     auto guard = reader.lock();
+//     int32_t port = (*guard)["port"].as_int32();
+//   }
+//
+//   // Writer thread.
+//   config.publish(Json::parse(new_text));
+//
+// The Json got from a guard must not be modified, and the references to
+// its values are valid until the guard is destroyed.
+class JsonSnapshot : public noncopyable
+{
+
+  // --------------------------------------------------------------------------
+  // Member types.
+ private:
+
+  // The slot of a reader, aligned to a cache line to avoid false sharing.
+  struct alignas(64) ReaderSlot
+  {
+    std::atomic<uint64_t> epoch{ 0 };     // 0 means not reading.
+    std::atomic<bool>     used{ false };
+    size_t                depth = 0;      // Only used by the owner.
+  };
+
+ public:
+
+  class Reader;
+
+  // A read-side critical section, the Json it points to will not be
+  // reclaimed until the Guard is destroyed. Guards can be nested.
+  class Guard : public noncopyable
+  {
+   public:
+    Guard(Guard&& other)
+      :slot_(other.slot_), json_(other.json_)
+    {
+      other.slot_ = nullptr;
+    }
+
+    ~Guard()
+    {
+      if (slot_ != nullptr && --slot_->depth == 0)
+      {
+        slot_->epoch.store(0, std::memory_order_release);
+      }
+    }
+
+    const Json& operator*()  const { return *json_; }
+    const Json* operator->() const { return json_; }
+    const Json* get()        const { return json_; }
+
+   private:
+    friend class Reader;
+
+    Guard(ReaderSlot* slot, const Json* json) :slot_(slot), json_(json) {}
+
+    ReaderSlot* slot_;
+    const Json* json_;
+  };
+
+  // A registered reader, each reading thread should have its own one.
+  class Reader : public noncopyable
+  {
+   public:
+    Reader(Reader&& other)
+      :owner_(other.owner_), slot_(other.slot_)
+    {
+      other.slot_ = nullptr;
+    }
+
+    ~Reader()
+    {
+      if (slot_ != nullptr)
+      {
+        slot_->used.store(false, std::memory_order_release);
+      }
+    }
+
+    // Enters a read-side critical section and gets the current version.
+    Guard lock() const
+    {
+      if (slot_->depth++ == 0)
+      {
+        slot_->epoch.store(owner_->epoch_.load(std::memory_order_acquire),
+                           std::memory_order_relaxed);
+        // Orders the store of the epoch before the load of the Json,
+        // pairs with the fence in publish().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+      return Guard(slot_, owner_->current_.load(std::memory_order_acquire));
+    }
+
+   private:
+    friend class JsonSnapshot;
+
+    Reader(const JsonSnapshot* owner, ReaderSlot* slot)
+      :owner_(owner), slot_(slot)
+    {
+    }
+
+    const JsonSnapshot* owner_;
+    ReaderSlot*         slot_;
+  };
+
+  // --------------------------------------------------------------------------
+  // Constructor / Destructor
+ public:
+
+  // Constructs with the first version, the max_readers is the maximum
+  // number of readers which can be registered at the same time.
+  explicit JsonSnapshot(Json json = Json(), size_t max_readers = 64);
+
+  // All the readers must have been destroyed.
+  ~JsonSnapshot();
+
+  // --------------------------------------------------------------------------
+  // Member functions.
+ public:
+
+  // Registers a reader, if there are already max_readers readers,
+  // an exception will be thrown.
+  Reader reader();
+
+  // Replaces the current version atomically, the old version is deleted
+  // when no reader can see it any more. Writers are serialized. Notes that
+  // the copies of Json share their values, so the other copies of the
+  // published Json must not be modified after this call.
+  void publish(Json json);
+
+  // Waits until all the old versions are deleted.
+  void synchronize();
+
+  // --------------------------------------------------------------------------
+  // Private member data and member functions.
+ private:
+
+  // Deletes the old versions which are not visible to any reader.
+  // The mutex must be held.
+  void _reclaim();
+
+  std::atomic<Json*>                      current_;
+  std::atomic<uint64_t>                   epoch_;
+  std::unique_ptr<ReaderSlot[]>           slots_;
+  size_t                                  max_readers_;
+  std::mutex                              mutex_;
+  std::vector<std::pair<uint64_t, Json*>> retired_;  // (epoch, version)
+
+};
+
+} // namespace json
+} // namespace parser
+} // namespace redbud
+#endif // !ALINSHANS_REDBUD_PARSER_JSON_SNAPSHOT_H_
@@ -0,0 +1,752 @@
+// ============================================================================
+// Copyright (c) 2017 Alinshans. All rights reserved.
+// Licensed under the MIT License. See LICENSE for details.
+//
+// Header File : redbud/parser/json_value.h
+//
+// This file contains the definition and implementation of JsonValue class
+// and its derived classes, which are the nodes of BasicJson.
+// ============================================================================
+
+#ifndef ALINSHANS_REDBUD_PARSER_JSON_VALUE_H_
+#define ALINSHANS_REDBUD_PARSER_JSON_VALUE_H_
+
+#include <atomic>            // atomic
+#include <cstddef>           // max_align_t
+#include <cstdint>
+#include <cstdlib>           // strtod
+
+#include <initializer_list>  // initializer_list
+#include <memory>            // allocator_traits
+#include <mutex>             // once_flag, call_once, mutex, lock_guard
+#include <new>               // placement new
+#include <utility>           // pair, move, forward
+
+#include "json_parser.h"
+#include "../exception.h"
+
+namespace redbud
+{
+namespace parser
+{
+namespace json
+{
+
+// ============================================================================
+// Base class : JsonValue
+
+template <typename JsonT>
+class JsonValue
+{
+
+ public:
+
+  using Type           = typename JsonT::Type;
+  using string_t       = typename JsonT::string_t;
+  using array_t        = typename JsonT::array_t;
+  using object_t       = typename JsonT::object_t;
+  using array_value_t  = typename JsonT::array_value_t;
+  using object_value_t = typename JsonT::object_value_t;
+  using number_array_t = typename JsonT::number_array_t;
+  using ref_policy     = typename JsonT::ref_policy;
+
+  JsonValue() :refs_(1) {}
+  virtual ~JsonValue() = default;
+
+  // Makes a Node<JsonT> by the allocator of JsonT, which is default
+  // constructed each time. The node is freed by the same allocator when its
+  // reference count becomes zero.
+  template <template <typename> class Node, typename... Args>
+  static JsonValue* make(Args&&... args);
+
+ protected:
+
+  friend JsonT;
+
+  // Reference count, the node destroys itself when the count becomes zero.
+  void add_ref() { ref_policy::increase(refs_); }
+  void release() { if (ref_policy::decrease(refs_)) destroy(); }
+
+  // Destroys this node and frees its memory, see JsonAllocated.
+  virtual void destroy() = 0;
+
+  // Allocates / frees n bytes by the allocator of JsonT.
+  static void* allocate(size_t n);
+  static void  deallocate(void* p, size_t n);
+
+  // Pure virtual functions.
+  virtual Type          type() const = 0;
+  virtual size_t        size() const = 0;
+
+  // Gets the JSON text of a lazy node, nullptr for the other nodes.
+  virtual const JsonTextView* raw() const { return nullptr; }
+
+  // Gets Json from JsonArray.
+  JsonT&                get_value_from_arr(size_t i);
+  const JsonT&          get_value_from_arr(size_t i) const;
+
+  // Gets Json from JsonObject.
+  JsonT&                get_value_from_obj(const string_t& key);
+  const JsonT&          get_value_from_obj(const string_t& key) const;
+
+  // If the types does not match, the corresponding instance
+  // will be returned.
+  bool                  get_bool_safe()   const;
+  double                get_double_safe() const;
+  const string_t*       get_number_text() const;
+  const string_t&       get_string_safe() const;
+  const array_t&        get_array_safe()  const;
+  const object_t&       get_object_safe() const;
+
+  // STL-like access.
+  void push_back(const array_value_t& value);
+  void push_back(array_value_t&& value);
+  void pop_back();
+  void insert(const object_value_t& pair);
+  void insert(object_value_t&& pair);
+  void erase(size_t i);
+  void erase(const string_t& key);
+
+ private:
+
+  // Allocates the memory in the unit of max_align_t.
+  using unit_t = std::max_align_t;
+  using unit_allocator = typename std::allocator_traits<
+    typename JsonT::allocator_type>::template rebind_alloc<unit_t>;
+  using unit_traits = std::allocator_traits<unit_allocator>;
+
+  static size_t units(size_t n)
+  {
+    return (n + sizeof(unit_t) - 1) / sizeof(unit_t);
+  }
+
+  typename ref_policy::count_t refs_;
+
+};
+
+// ============================================================================
+// Derived class, representing the specific type of JSON.
+
+template <typename JsonT>
+class JsonNull : public JsonValue<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::Type;
+
+  // override
+  Type   type() const override { return Type::kJsonNull; }
+  size_t size() const override { return 1; }
+
+};
+
+template <typename JsonT>
+class JsonBool : public JsonValue<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::Type;
+
+  JsonBool() = default;
+  JsonBool(bool b) :value_(b) {}
+  ~JsonBool() = default;
+
+  // override
+  Type   type() const override { return Type::kJsonBool; }
+  size_t size() const override { return 1; }
+
+ private:
+  bool value_;
+
+};
+
+template <typename JsonT>
+class JsonNumber : public JsonValue<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::Type;
+  using typename JsonValue<JsonT>::string_t;
+
+  JsonNumber() = default;
+  JsonNumber(int32_t n) :value_(static_cast<double>(n)) {}
+  JsonNumber(uint32_t n) :value_(static_cast<double>(n)) {}
+  JsonNumber(int64_t n) :value_(static_cast<double>(n)) {}
+  JsonNumber(uint64_t n) :value_(static_cast<double>(n)) {}
+  JsonNumber(double n) :value_(n) {}
+  ~JsonNumber() = default;
+
+  // override
+  Type   type() const override { return Type::kJsonNumber; }
+  size_t size() const override { return 1; }
+
+  // Gets the value of the number.
+  virtual double value() const { return value_; }
+
+  // Gets the original text of the number, nullptr if it is not kept.
+  virtual const string_t* text() const { return nullptr; }
+
+ protected:
+  double value_;
+
+};
+
+// A number which is kept in its original text because double can not
+// represent it exactly, the value of JsonNumber is the nearest double.
+template <typename JsonT>
+class JsonBigNumber : public JsonNumber<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::string_t;
+
+  JsonBigNumber(string_t&& text, double d)
+    :JsonNumber<JsonT>(d), text_(std::move(text))
+  {
+  }
+  ~JsonBigNumber() = default;
+
+  // override
+  const string_t* text() const override { return &text_; }
+
+ private:
+  string_t text_;
+
+};
+
+// A number parsed in lazy mode, which is converted from the JSON text on the
+// first access.
+template <typename JsonT>
+class JsonLazyNumber : public JsonNumber<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  JsonLazyNumber(JsonTextView&& text)
+    :JsonNumber<JsonT>(0.0), text_(std::move(text))
+  {
+  }
+  ~JsonLazyNumber() = default;
+
+  // override
+  double value() const override
+  {
+    std::call_once(decoded_, [this] {
+      // The text has been validated and is followed by a non-number
+      // character, so strtod stops at the end of the number.
+      const_cast<JsonLazyNumber*>(this)->value_ =
+        std::strtod(text_.data(), nullptr);
+    });
+    return this->value_;
+  }
+  const JsonTextView* raw() const override { return &text_; }
+
+ private:
+  JsonTextView           text_;
+  mutable std::once_flag decoded_;
+
+};
+
+template <typename JsonT>
+class JsonString : public JsonValue<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::Type;
+  using typename JsonValue<JsonT>::string_t;
+
+  JsonString() = default;
+  JsonString(const char* sz) :value_(sz) {}
+  JsonString(const string_t& str) :value_(str) {}
+  JsonString(string_t&& str) :value_(std::move(str)) {}
+  ~JsonString() = default;
+
+  // override
+  Type   type() const override { return Type::kJsonString; }
+  size_t size() const override { return 1; }
+
+  // Gets the value of the string.
+  virtual const string_t& value() const { return value_; }
+
+ protected:
+  string_t value_;
+
+};
+
+// A string parsed in lazy mode, whose escaped characters are decoded from
+// the JSON text on the first access.
+template <typename JsonT>
+class JsonLazyString : public JsonString<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::string_t;
+
+  JsonLazyString(JsonTextView&& text) :text_(std::move(text)) {}
+  ~JsonLazyString() = default;
+
+  // override
+  const string_t& value() const override
+  {
+    std::call_once(decoded_, [this] {
+      const_cast<JsonLazyString*>(this)->value_ =
+        JsonParser<JsonT>::decode_string(text_.data(), text_.len);
+    });
+    return this->value_;
+  }
+  const JsonTextView* raw() const override { return &text_; }
+
+ private:
+  JsonTextView           text_;
+  mutable std::once_flag decoded_;
+
+};
+
+template <typename JsonT>
+class JsonArray : public JsonValue<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::Type;
+  using typename JsonValue<JsonT>::array_t;
+  using typename JsonValue<JsonT>::number_array_t;
+
+  JsonArray() = default;
+  JsonArray(const array_t& a) :value_(a) {}
+  JsonArray(array_t&& a) :value_(std::move(a)) {}
+  JsonArray(std::initializer_list<JsonT> ilist)
+    :value_(ilist.begin(), ilist.end())
+  {
+  }
+  ~JsonArray() = default;
+
+  // override
+  Type   type() const override { return Type::kJsonArray; }
+  size_t size() const override { return value_.size(); }
+
+  // Gets the elements, a packed array builds them on the first call.
+  // The non-const one is for changing the array, e.g. erasing an element,
+  // so it also drops the packed numbers.
+  virtual const array_t& elements() const { return value_; }
+  virtual array_t&       elements()       { return value_; }
+
+  // Gets an element which may be modified, a packed array stays packed and
+  // refreshes its numbers from the elements when they are read next time.
+  virtual JsonT& element(size_t i) { return value_[i]; }
+
+  // Gets the packed numbers, nullptr if the array is not packed.
+  virtual const number_array_t* numbers() const { return nullptr; }
+
+  // Appends a number and keeps the array packed, returns false if the array
+  // is not packed.
+  virtual bool push_number(double) { return false; }
+
+ protected:
+  array_t value_;
+
+};
+
+// A JSON array whose elements are all numbers, the numbers are stored in a
+// contiguous buffer instead of a JsonNumber node per element. The elements
+// are only built when the generic interface needs them.
+template <typename JsonT>
+class JsonPackedArray : public JsonArray<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::array_t;
+  using typename JsonValue<JsonT>::number_array_t;
+
+  JsonPackedArray(const number_array_t& n) :numbers_(n) {}
+  JsonPackedArray(number_array_t&& n) :numbers_(std::move(n)) {}
+  ~JsonPackedArray() = default;
+
+  // override
+  size_t size() const override
+  {
+    return packed_ ? numbers_.size() : this->value_.size();
+  }
+
+  const array_t& elements() const override
+  {
+    if (packed_)
+    {
+      // Readers may build the elements at the same time.
+      std::call_once(built_, [this] {
+        auto& value = const_cast<JsonPackedArray*>(this)->value_;
+        value.reserve(numbers_.size());
+        for (double d : numbers_)
+        {
+          value.push_back(JsonT(d));
+        }
+        const_cast<JsonPackedArray*>(this)->has_elements_ = true;
+      });
+    }
+    return this->value_;
+  }
+
+  array_t& elements() override
+  {
+    if (packed_)
+    {
+      static_cast<const JsonPackedArray&>(*this).elements();
+      numbers_ = number_array_t();
+      packed_ = false;
+    }
+    return this->value_;
+  }
+
+  JsonT& element(size_t i) override
+  {
+    if (packed_)
+    {
+      static_cast<const JsonPackedArray&>(*this).elements();
+      state_.store(State::kDirty, std::memory_order_relaxed);
+    }
+    return this->value_[i];
+  }
+
+  const number_array_t* numbers() const override
+  {
+    if (!packed_)
+    {
+      return nullptr;
+    }
+    State s = state_.load(std::memory_order_acquire);
+    if (s == State::kDirty)
+    {
+      s = _refresh();
+    }
+    return s == State::kClean ? &numbers_ : nullptr;
+  }
+
+  bool push_number(double d) override
+  {
+    if (!packed_ || state_.load(std::memory_order_relaxed) == State::kMixed)
+    {
+      return false;
+    }
+    numbers_.push_back(d);
+    if (has_elements_)
+    {
+      // Keeps the built elements in step with the numbers.
+      this->value_.push_back(JsonT(d));
+    }
+    return true;
+  }
+
+ private:
+  // Whether the numbers are in step with the elements, kDirty after an
+  // element may have been modified, kMixed if an element is not a plain
+  // number any more.
+  enum class State : uint8_t
+  {
+    kClean = 0,
+    kDirty = 1,
+    kMixed = 2
+  };
+
+  // Copies the elements back into the numbers, readers may do it at the
+  // same time, so it is done under the lock.
+  State _refresh() const
+  {
+    std::lock_guard<std::mutex> lock(refresh_);
+    State s = state_.load(std::memory_order_relaxed);
+    if (s != State::kDirty)
+    {
+      return s;
+    }
+    auto& numbers = const_cast<JsonPackedArray*>(this)->numbers_;
+    s = State::kClean;
+    for (size_t i = 0; i < numbers.size(); ++i)
+    {
+      const JsonT& e = this->value_[i];
+      if (!e.is_number() || e.is_bignum() || e.is_lazy())
+      {
+        s = State::kMixed;
+        break;
+      }
+      numbers[i] = e.as_double();
+    }
+    state_.store(s, std::memory_order_release);
+    return s;
+  }
+
+  number_array_t             numbers_;
+  bool                       packed_ = true;
+  bool                       has_elements_ = false;
+  mutable std::once_flag     built_;
+  mutable std::mutex         refresh_;
+  mutable std::atomic<State> state_ = State::kClean;
+
+};
+
+template <typename JsonT>
+class JsonObject : public JsonValue<JsonT>
+{
+
+ public:
+
+  friend JsonT;
+  friend class JsonValue<JsonT>;
+
+  using typename JsonValue<JsonT>::Type;
+  using typename JsonValue<JsonT>::string_t;
+  using typename JsonValue<JsonT>::object_t;
+
+  JsonObject() = default;
+  JsonObject(const object_t& o) :value_(o) {}
+  JsonObject(object_t&& o) :value_(std::move(o)) {}
+  JsonObject(std::initializer_list<std::pair<string_t, JsonT>> ilist)
+    :value_(ilist.begin(), ilist.end())
+  {
+  }
+  ~JsonObject() = default;
+
+  // override
+  Type   type() const override { return Type::kJsonObject; }
+  size_t size() const override { return value_.size(); }
+
+ private:
+  object_t value_;
+
+};
+
+// ============================================================================
+// JsonAllocated class
+//
+// The most derived class of a node made by JsonValue::make, which knows the
+// size of the node to free.
+
+template <typename JsonT, template <typename> class Node>
+class JsonAllocated final : public Node<JsonT>
+{
+
+ public:
+
+  using Node<JsonT>::Node;
+
+ protected:
+
+  void destroy() override
+  {
+    void* p = this;
+    this->~JsonAllocated();
+    JsonValue<JsonT>::deallocate(p, sizeof(JsonAllocated));
+  }
+
+};
+
+// ============================================================================
+// Implementation of JsonValue.
+
+// ----------------------------------------------------------------------------
+// Allocation.
+
+template <typename JsonT>
+template <template <typename> class Node, typename... Args>
+JsonValue<JsonT>* JsonValue<JsonT>::make(Args&&... args)
+{
+  using node_t = JsonAllocated<JsonT, Node>;
+  void* p = allocate(sizeof(node_t));
+  try
+  {
+    return ::new (p) node_t(std::forward<Args>(args)...);
+  }
+  catch (...)
+  {
+    deallocate(p, sizeof(node_t));
+    throw;
+  }
+}
+
+template <typename JsonT>
+void* JsonValue<JsonT>::allocate(size_t n)
+{
+  unit_allocator alloc;
+  return unit_traits::allocate(alloc, units(n));
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::deallocate(void* p, size_t n)
+{
+  unit_allocator alloc;
+  unit_traits::deallocate(alloc, static_cast<unit_t*>(p), units(n));
+}
+
+// ----------------------------------------------------------------------------
+// Member functions.
+
+template <typename JsonT>
+JsonT& JsonValue<JsonT>::get_value_from_arr(size_t index)
+{
+  return static_cast<JsonArray<JsonT>&>(*this).element(index);
+}
+
+template <typename JsonT>
+const JsonT& JsonValue<JsonT>::get_value_from_arr(size_t index) const
+{
+  const auto& arr = static_cast<const JsonArray<JsonT>&>(*this).elements();
+  return arr[index];
+}
+
+template <typename JsonT>
+JsonT& JsonValue<JsonT>::get_value_from_obj(const string_t& key)
+{
+  auto& obj = static_cast<JsonObject<JsonT>&>(*this).value_;
+  return obj[key];
+}
+
+template <typename JsonT>
+const JsonT& JsonValue<JsonT>::get_value_from_obj(const string_t& key) const
+{
+  const auto& obj = static_cast<const JsonObject<JsonT>&>(*this).value_;
+  const auto& key_pos = obj.find(key);
+  REDBUD_THROW_EX_IF(key_pos == obj.cend(), "Json no such key.");
+  return key_pos->second;
+}
+
+template <typename JsonT>
+bool JsonValue<JsonT>::get_bool_safe() const
+{
+  return static_cast<const JsonBool<JsonT>&>(*this).value_;
+}
+
+template <typename JsonT>
+double JsonValue<JsonT>::get_double_safe() const
+{
+  return static_cast<const JsonNumber<JsonT>&>(*this).value();
+}
+
+template <typename JsonT>
+const typename JsonValue<JsonT>::string_t*
+JsonValue<JsonT>::get_number_text() const
+{
+  return static_cast<const JsonNumber<JsonT>&>(*this).text();
+}
+
+template <typename JsonT>
+const typename JsonValue<JsonT>::string_t&
+JsonValue<JsonT>::get_string_safe() const
+{
+  return static_cast<const JsonString<JsonT>&>(*this).value();
+}
+
+template <typename JsonT>
+const typename JsonValue<JsonT>::array_t&
+JsonValue<JsonT>::get_array_safe() const
+{
+  return static_cast<const JsonArray<JsonT>&>(*this).elements();
+}
+
+template <typename JsonT>
+const typename JsonValue<JsonT>::object_t&
+JsonValue<JsonT>::get_object_safe() const
+{
+  return static_cast<const JsonObject<JsonT>&>(*this).value_;
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::push_back(const array_value_t& value)
+{
+  auto& node = static_cast<JsonArray<JsonT>&>(*this);
+  // Only a plain number is packed, the others keep their own node.
+  if (value.is_number() && !value.is_bignum() && !value.is_lazy()
+      && node.push_number(value.as_double()))
+  {
+    return;
+  }
+  node.elements().push_back(value);
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::push_back(array_value_t&& value)
+{
+  auto& node = static_cast<JsonArray<JsonT>&>(*this);
+  // Only a plain number is packed, the others keep their own node.
+  if (value.is_number() && !value.is_bignum() && !value.is_lazy()
+      && node.push_number(value.as_double()))
+  {
+    return;
+  }
+  node.elements().push_back(std::move(value));
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::pop_back()
+{
+  auto& arr = static_cast<JsonArray<JsonT>&>(*this).elements();
+  arr.pop_back();
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::insert(const object_value_t& p)
+{
+  auto& obj = static_cast<JsonObject<JsonT>&>(*this).value_;
+  obj[p.first] = p.second;
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::insert(object_value_t&& p)
+{
+  auto& obj = static_cast<JsonObject<JsonT>&>(*this).value_;
+  obj[p.first] = std::move(p.second);
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::erase(size_t i)
+{
+  auto& arr = static_cast<JsonArray<JsonT>&>(*this).elements();
+  if (arr.size() <= i)
+  {
+    return;
+  }
+  arr.erase(arr.begin() + i);
+}
+
+template <typename JsonT>
+void JsonValue<JsonT>::erase(const string_t& key)
+{
+  auto& obj = static_cast<JsonObject<JsonT>&>(*this).value_;
+  obj.erase(key);
+}
+
+} // namespace json
+} // namespace parser
+} // namespace redbud
+#endif // !ALINSHANS_REDBUD_PARSER_JSON_VALUE_H_
@@ -0,0 +1,1190 @@
+// ============================================================================
+// Copyright (c) 2017 Alinshans. All rights reserved.
+// Licensed under the MIT License. See LICENSE for details.
+//
+// Source File : redbud/parser/persistent_json.cc
+//
+// This file contains the definition and implementation of the nodes of
+// PersistentJson, and contains the implementation of PersistentJson class.
+// ============================================================================
+
+#include "persistent_json.h"
+
+#include <algorithm>
+#include <map>
+
+#include "../exception.h"
+
+namespace redbud
+{
+namespace parser
+{
+namespace json
+{
+
+// ============================================================================
+// Macro definition.
+
+// Each level of the tries consumes 5 bits of the index or the hash.
+#define TRIE_BITS   (5u)
+#define TRIE_WIDTH  (1u << TRIE_BITS)
+#define TRIE_MASK   (TRIE_WIDTH - 1)
+
+// The HAMT runs out of hash bits beyond this shift.
+#define HASH_BITS   (32u)
+
+#define EXPECT_ARRAY                                    \
+  REDBUD_THROW_EX_IF(type() != Json::Type::kJsonArray,  \
+                  "Expecting a Json array.")
+
+#define EXPECT_OBJECT                                   \
+  REDBUD_THROW_EX_IF(type() != Json::Type::kJsonObject, \
+                  "Expecting a Json object.")
+
+// ============================================================================
+// Nodes of the persistent vector trie.
+//
+// A leaf holds up to 32 values, an internal node holds up to 32 children.
+// The index i is found by taking 5 bits of i at each level from the root.
+
+struct VectorNode
+{
+  std::vector<std::shared_ptr<const VectorNode>> children;
+  std::vector<PersistentJson>                    values;
+};
+
+using VectorPtr = std::shared_ptr<const VectorNode>;
+
+// ============================================================================
+// Nodes of the hash array mapped trie.
+//
+// Each node has a 32-bit bitmap, the nth bit indicates whether there is an
+// entry for the 5-bit hash fragment n, and the entries are stored compactly
+// in the order of their bits. An entry is either a key-value pair or a
+// subnode. The keys whose hashes are fully equal are kept in a collision
+// node, whose entries are a plain list.
+
+struct HamtNode;
+
+struct HamtEntry
+{
+  std::shared_ptr<const HamtNode> sub;
+  uint32_t                        hash;
+  PersistentJson::string_t        key;
+  PersistentJson                  value;
+};
+
+struct HamtNode
+{
+  uint32_t               bitmap = 0;
+  bool                   collision = false;
+  std::vector<HamtEntry> entries;
+};
+
+using HamtPtr = std::shared_ptr<const HamtNode>;
+
+// ============================================================================
+// Base class : PersistentNode
+
+class PersistentNode
+{
+
+ public:
+
+  virtual ~PersistentNode() = default;
+
+  virtual Json::Type type() const = 0;
+
+};
+
+// ============================================================================
+// Derived class, representing the specific type of JSON.
+
+// Boolean, number and string share the node of a Json.
+class PersistentScalar : public PersistentNode
+{
+
+ public:
+
+  explicit PersistentScalar(const Json& j) :value_(j) {}
+
+  // override
+  Json::Type type() const override { return value_.type(); }
+
+  Json value_;
+
+};
+
+class PersistentArray : public PersistentNode
+{
+
+ public:
+
+  PersistentArray(size_t size, uint32_t shift, VectorPtr root)
+    :size_(size), shift_(shift), root_(std::move(root))
+  {
+  }
+
+  // override
+  Json::Type type() const override { return Json::Type::kJsonArray; }
+
+  size_t    size_;
+  uint32_t  shift_;
+  VectorPtr root_;
+
+};
+
+class PersistentObject : public PersistentNode
+{
+
+ public:
+
+  PersistentObject(size_t size, HamtPtr root)
+    :size_(size), root_(std::move(root))
+  {
+  }
+
+  // override
+  Json::Type type() const override { return Json::Type::kJsonObject; }
+
+  size_t  size_;
+  HamtPtr root_;
+
+};
+
+// ============================================================================
+// Helper functions of the persistent vector trie.
+
+// Returns the leaf which contains the index i.
+static const VectorNode* vector_leaf(const PersistentArray& a, size_t i)
+{
+  const VectorNode* node = a.root_.get();
+  for (uint32_t level = a.shift_; level > 0; level -= TRIE_BITS)
+  {
+    node = node->children[(i >> level) & TRIE_MASK].get();
+  }
+  return node;
+}
+
+// Returns a copy of the path to the index i, whose value is replaced.
+static VectorPtr vector_set(const VectorNode* node, uint32_t level,
+                            size_t i, const PersistentJson& value)
+{
+  auto copy = std::make_shared<VectorNode>(*node);
+  if (level == 0)
+  {
+    copy->values[i & TRIE_MASK] = value;
+  }
+  else
+  {
+    size_t slot = (i >> level) & TRIE_MASK;
+    copy->children[slot] = vector_set(node->children[slot].get(),
+                                      level - TRIE_BITS, i, value);
+  }
+  return copy;
+}
+
+// Returns a copy of the path to the index i, the value is appended at i.
+// The node can be nullptr when the path does not exist yet.
+static VectorPtr vector_push(const VectorNode* node, uint32_t level,
+                             size_t i, const PersistentJson& value)
+{
+  auto copy = node ? std::make_shared<VectorNode>(*node)
+                   : std::make_shared<VectorNode>();
+  if (level == 0)
+  {
+    copy->values.push_back(value);
+  }
+  else
+  {
+    size_t slot = (i >> level) & TRIE_MASK;
+    if (slot < copy->children.size())
+    {
+      copy->children[slot] = vector_push(copy->children[slot].get(),
+                                         level - TRIE_BITS, i, value);
+    }
+    else
+    {
+      copy->children.push_back(
+        vector_push(nullptr, level - TRIE_BITS, i, value));
+    }
+  }
+  return copy;
+}
+
+// Returns a copy of the path to the index i, which is the last one, and the
+// value at i is removed. Returns nullptr if the node becomes empty.
+static VectorPtr vector_pop(const VectorNode* node, uint32_t level, size_t i)
+{
+  if (level == 0)
+  {
+    if ((i & TRIE_MASK) == 0)
+    {
+      return nullptr;
+    }
+    auto copy = std::make_shared<VectorNode>(*node);
+    copy->values.pop_back();
+    return copy;
+  }
+  size_t slot = (i >> level) & TRIE_MASK;
+  auto child = vector_pop(node->children[slot].get(), level - TRIE_BITS, i);
+  if (child == nullptr && slot == 0)
+  {
+    return nullptr;
+  }
+  auto copy = std::make_shared<VectorNode>(*node);
+  if (child == nullptr)
+  {
+    copy->children.pop_back();
+  }
+  else
+  {
+    copy->children[slot] = std::move(child);
+  }
+  return copy;
+}
+
+// Builds a trie from the values level by level, sets the shift of the root.
+static VectorPtr vector_build(std::vector<PersistentJson>&& values,
+                              uint32_t& shift)
+{
+  shift = 0;
+  if (values.empty())
+  {
+    return nullptr;
+  }
+  std::vector<VectorPtr> level;
+  level.reserve((values.size() + TRIE_MASK) / TRIE_WIDTH);
+  for (size_t i = 0; i < values.size(); i += TRIE_WIDTH)
+  {
+    auto leaf = std::make_shared<VectorNode>();
+    size_t last = std::min(values.size(), i + TRIE_WIDTH);
+    leaf->values.assign(std::make_move_iterator(values.begin() + i),
+                        std::make_move_iterator(values.begin() + last));
+    level.push_back(std::move(leaf));
+  }
+  while (level.size() > 1)
+  {
+    std::vector<VectorPtr> upper;
+    upper.reserve((level.size() + TRIE_MASK) / TRIE_WIDTH);
+    for (size_t i = 0; i < level.size(); i += TRIE_WIDTH)
+    {
+      auto node = std::make_shared<VectorNode>();
+      size_t last = std::min(level.size(), i + TRIE_WIDTH);
+      node->children.assign(level.begin() + i, level.begin() + last);
+      upper.push_back(std::move(node));
+    }
+    level.swap(upper);
+    shift += TRIE_BITS;
+  }
+  return level.front();
+}
+
+static void vector_for_each(
+  const VectorNode* node, uint32_t level, size_t& i,
+  const std::function<void(size_t, const PersistentJson&)>& f)
+{
+  if (level == 0)
+  {
+    for (const auto& v : node->values)
+    {
+      f(i++, v);
+    }
+    return;
+  }
+  for (const auto& child : node->children)
+  {
+    vector_for_each(child.get(), level - TRIE_BITS, i, f);
+  }
+}
+
+// Diffs two subtries at the same level whose first index is base, calls f
+// for the values of the indices less than common. The shared subtries are
+// skipped, so only the paths to the edits are visited.
+static void vector_diff(
+  const VectorNode* a, const VectorNode* b, uint32_t level, size_t base,
+  size_t common,
+  const std::function<void(size_t, const PersistentJson&,
+                           const PersistentJson&)>& f)
+{
+  if (a == b || base >= common)
+  {
+    return;
+  }
+  if (level == 0)
+  {
+    size_t n = std::min<size_t>(TRIE_WIDTH, common - base);
+    for (size_t j = 0; j < n; ++j)
+    {
+      f(base + j, a->values[j], b->values[j]);
+    }
+    return;
+  }
+  size_t span = static_cast<size_t>(1) << level;
+  size_t n = std::min(a->children.size(), b->children.size());
+  for (size_t k = 0; k < n; ++k)
+  {
+    vector_diff(a->children[k].get(), b->children[k].get(),
+                level - TRIE_BITS, base + k * span, common, f);
+  }
+}
+
+// ============================================================================
+// Helper functions of the hash array mapped trie.
+
+static uint32_t key_hash(const PersistentJson::string_t& key)
+{
+  uint64_t h = std::hash<PersistentJson::string_t>()(key);
+  return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+static uint32_t bit_count(uint32_t x)
+{
+  x = x - ((x >> 1) & 0x55555555u);
+  x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+  x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+  return (x * 0x01010101u) >> 24;
+}
+
+static uint32_t hamt_bit(uint32_t hash, uint32_t shift)
+{
+  return 1u << ((hash >> shift) & TRIE_MASK);
+}
+
+static size_t hamt_index(const HamtNode* node, uint32_t bit)
+{
+  return bit_count(node->bitmap & (bit - 1));
+}
+
+static const PersistentJson* hamt_find(const HamtNode* node, uint32_t hash,
+                                       const PersistentJson::string_t& key)
+{
+  for (uint32_t shift = 0; node != nullptr; shift += TRIE_BITS)
+  {
+    if (node->collision)
+    {
+      for (const auto& e : node->entries)
+      {
+        if (e.key == key)
+        {
+          return &e.value;
+        }
+      }
+      return nullptr;
+    }
+    uint32_t bit = hamt_bit(hash, shift);
+    if ((node->bitmap & bit) == 0)
+    {
+      return nullptr;
+    }
+    const auto& e = node->entries[hamt_index(node, bit)];
+    if (e.sub == nullptr)
+    {
+      return e.key == key ? &e.value : nullptr;
+    }
+    node = e.sub.get();
+  }
+  return nullptr;
+}
+
+// Makes a node at the shift which contains two different keys.
+static HamtPtr hamt_pair(const HamtEntry& a, const HamtEntry& b,
+                         uint32_t shift)
+{
+  auto node = std::make_shared<HamtNode>();
+  if (shift >= HASH_BITS)
+  {
+    node->collision = true;
+    node->entries = { a, b };
+    return node;
+  }
+  uint32_t bit_a = hamt_bit(a.hash, shift);
+  uint32_t bit_b = hamt_bit(b.hash, shift);
+  if (bit_a == bit_b)
+  {
+    node->bitmap = bit_a;
+    node->entries.push_back(
+      HamtEntry{ hamt_pair(a, b, shift + TRIE_BITS), 0, {}, {} });
+  }
+  else
+  {
+    node->bitmap = bit_a | bit_b;
+    node->entries = bit_a < bit_b ? std::vector<HamtEntry>{ a, b }
+                                  : std::vector<HamtEntry>{ b, a };
+  }
+  return node;
+}
+
+// Returns a copy of the path to the key, whose value is inserted or replaced.
+static HamtPtr hamt_assoc(const HamtPtr& node, uint32_t shift,
+                          const HamtEntry& kv, bool& added)
+{
+  if (node == nullptr)
+  {
+    added = true;
+    auto leaf = std::make_shared<HamtNode>();
+    leaf->bitmap = hamt_bit(kv.hash, shift);
+    leaf->entries.push_back(kv);
+    return leaf;
+  }
+  if (node->collision)
+  {
+    auto copy = std::make_shared<HamtNode>(*node);
+    for (auto& e : copy->entries)
+    {
+      if (e.key == kv.key)
+      {
+        e.value = kv.value;
+        return copy;
+      }
+    }
+    added = true;
+    copy->entries.push_back(kv);
+    return copy;
+  }
+  uint32_t bit = hamt_bit(kv.hash, shift);
+  size_t idx = hamt_index(node.get(), bit);
+  if ((node->bitmap & bit) == 0)
+  {
+    added = true;
+    auto copy = std::make_shared<HamtNode>(*node);
+    copy->bitmap |= bit;
+    copy->entries.insert(copy->entries.begin() + idx, kv);
+    return copy;
+  }
+  const auto& e = node->entries[idx];
+  if (e.sub == nullptr && e.key == kv.key && e.value.same(kv.value))
+  {
+    return node;
+  }
+  auto copy = std::make_shared<HamtNode>(*node);
+  auto& ce = copy->entries[idx];
+  if (e.sub != nullptr)
+  {
+    ce.sub = hamt_assoc(e.sub, shift + TRIE_BITS, kv, added);
+  }
+  else if (e.key == kv.key)
+  {
+    ce.value = kv.value;
+  }
+  else
+  {
+    added = true;
+    ce = HamtEntry{ hamt_pair(e, kv, shift + TRIE_BITS), 0, {}, {} };
+  }
+  return copy;
+}
+
+// Returns a copy of the path to the key, whose key-value pair is removed.
+// Returns nullptr if the node becomes empty.
+static HamtPtr hamt_dissoc(const HamtPtr& node, uint32_t shift, uint32_t hash,
+                           const PersistentJson::string_t& key, bool& removed)
+{
+  if (node == nullptr)
+  {
+    return node;
+  }
+  if (node->collision)
+  {
+    auto it = std::find_if(node->entries.begin(), node->entries.end(),
+                           [&key](const HamtEntry& e) { return e.key == key; });
+    if (it == node->entries.end())
+    {
+      return node;
+    }
+    removed = true;
+    if (node->entries.size() == 1)
+    {
+      return nullptr;
+    }
+    auto copy = std::make_shared<HamtNode>(*node);
+    copy->entries.erase(copy->entries.begin() + (it - node->entries.begin()));
+    return copy;
+  }
+  uint32_t bit = hamt_bit(hash, shift);
+  if ((node->bitmap & bit) == 0)
+  {
+    return node;
+  }
+  size_t idx = hamt_index(node.get(), bit);
+  const auto& e = node->entries[idx];
+  HamtPtr sub;
+  if (e.sub != nullptr)
+  {
+    sub = hamt_dissoc(e.sub, shift + TRIE_BITS, hash, key, removed);
+    if (!removed)
+    {
+      return node;
+    }
+  }
+  else if (e.key == key)
+  {
+    removed = true;
+  }
+  else
+  {
+    return node;
+  }
+  if (sub == nullptr && node->entries.size() == 1)
+  {
+    return nullptr;
+  }
+  auto copy = std::make_shared<HamtNode>(*node);
+  if (sub == nullptr)
+  {
+    copy->bitmap &= ~bit;
+    copy->entries.erase(copy->entries.begin() + idx);
+  }
+  else if (sub->entries.size() == 1 && sub->entries[0].sub == nullptr)
+  { // Pulls up the only key-value pair left in the subnode.
+    copy->entries[idx] = sub->entries[0];
+  }
+  else
+  {
+    copy->entries[idx].sub = std::move(sub);
+  }
+  return copy;
+}
+
+static void hamt_for_each(
+  const HamtNode* node,
+  const std::function<void(const PersistentJson::string_t&,
+                           const PersistentJson&)>& f)
+{
+  if (node == nullptr)
+  {
+    return;
+  }
+  for (const auto& e : node->entries)
+  {
+    if (e.sub != nullptr)
+    {
+      hamt_for_each(e.sub.get(), f);
+    }
+    else
+    {
+      f(e.key, e.value);
+    }
+  }
+}
+
+// Collects all key-value pairs in the entry.
+static void hamt_collect(
+  const HamtEntry& e,
+  std::map<PersistentJson::string_t, const PersistentJson*>& out)
+{
+  if (e.sub == nullptr)
+  {
+    out[e.key] = &e.value;
+    return;
+  }
+  hamt_for_each(e.sub.get(), [&out](const PersistentJson::string_t& k,
+                                    const PersistentJson& v) {
+    out[k] = &v;
+  });
+}
+
+// ============================================================================
+// Helper functions of diff.
+
+// Appends a reference token to a JSON Pointer, '~' and '/' are escaped.
+static void pointer_append(PersistentJson::string_t& path,
+                           const PersistentJson::string_t& token)
+{
+  path.push_back('/');
+  for (char ch : token)
+  {
+    if (ch == '~')
+    {
+      path.append("~0");
+    }
+    else if (ch == '/')
+    {
+      path.append("~1");
+    }
+    else
+    {
+      path.push_back(ch);
+    }
+  }
+}
+
+// ============================================================================
+// Implementation of PersistentJson class.
+
+// ----------------------------------------------------------------------------
+// Constructor
+
+PersistentJson::PersistentJson()
+  :node_()
+{
+}
+
+PersistentJson::PersistentJson(const Json& j)
+  :node_()
+{
+  switch (j.type())
+  {
+    case Type::kJsonNull:
+      break;
+    case Type::kJsonArray:
+    {
+      std::vector<PersistentJson> values;
+      values.reserve(j.size());
+      for (const auto& v : j.as_array())
+      {
+        values.emplace_back(v);
+      }
+      size_t size = values.size();
+      uint32_t shift = 0;
+      auto root = vector_build(std::move(values), shift);
+      node_ = std::make_shared<PersistentArray>(size, shift, std::move(root));
+      break;
+    }
+    case Type::kJsonObject:
+    {
+      HamtPtr root;
+      for (const auto& p : j.as_object())
+      {
+        bool added = false;
+        root = hamt_assoc(root, 0,
+                          HamtEntry{ nullptr, key_hash(p.first),
+                                     p.first, PersistentJson(p.second) },
+                          added);
+      }
+      node_ = std::make_shared<PersistentObject>(j.size(), std::move(root));
+      break;
+    }
+    default:
+      node_ = std::make_shared<PersistentScalar>(j);
+      break;
+  }
+}
+
+PersistentJson::PersistentJson(std::shared_ptr<const PersistentNode> node)
+  :node_(std::move(node))
+{
+}
+
+// ----------------------------------------------------------------------------
+// Element access.
+
+Json::Type PersistentJson::type() const
+{
+  return node_ == nullptr ? Type::kJsonNull : node_->type();
+}
+
+bool PersistentJson::is_null()   const { return type() == Type::kJsonNull; }
+bool PersistentJson::is_bool()   const { return type() == Type::kJsonBool; }
+bool PersistentJson::is_number() const { return type() == Type::kJsonNumber; }
+bool PersistentJson::is_string() const { return type() == Type::kJsonString; }
+bool PersistentJson::is_array()  const { return type() == Type::kJsonArray; }
+bool PersistentJson::is_object() const { return type() == Type::kJsonObject; }
+
+// Returns the Json of a scalar, or a null Json for other types, so that
+// the Json yields the exception if the types do not match.
+static const Json& scalar_of(const PersistentNode* node)
+{
+  static const Json null_json;
+  auto scalar = dynamic_cast<const PersistentScalar*>(node);
+  return scalar == nullptr ? null_json : scalar->value_;
+}
+
+bool PersistentJson::as_bool() const
+{
+  return scalar_of(node_.get()).as_bool();
+}
+
+int32_t PersistentJson::as_int32() const
+{
+  return scalar_of(node_.get()).as_int32();
+}
+
+uint32_t PersistentJson::as_uint32() const
+{
+  return scalar_of(node_.get()).as_uint32();
+}
+
+int64_t PersistentJson::as_int64() const
+{
+  return scalar_of(node_.get()).as_int64();
+}
+
+uint64_t PersistentJson::as_uint64() const
+{
+  return scalar_of(node_.get()).as_uint64();
+}
+
+double PersistentJson::as_double() const
+{
+  return scalar_of(node_.get()).as_double();
+}
+
+const PersistentJson::string_t& PersistentJson::as_string() const
+{
+  return scalar_of(node_.get()).as_string();
+}
+
+const PersistentJson& PersistentJson::operator[](size_t index) const
+{
+  EXPECT_ARRAY;
+  const auto& a = static_cast<const PersistentArray&>(*node_);
+  REDBUD_THROW_EX_IF(a.size_ <= index, "Json index out of range.");
+  return vector_leaf(a, index)->values[index & TRIE_MASK];
+}
+
+const PersistentJson& PersistentJson::operator[](const string_t& key) const
+{
+  auto value = find(key);
+  REDBUD_THROW_EX_IF(value == nullptr, "Json no such key.");
+  return *value;
+}
+
+const PersistentJson* PersistentJson::find(const string_t& key) const
+{
+  EXPECT_OBJECT;
+  const auto& o = static_cast<const PersistentObject&>(*node_);
+  return hamt_find(o.root_.get(), key_hash(key), key);
+}
+
+bool PersistentJson::has_key(const string_t& key) const
+{
+  return find(key) != nullptr;
+}
+
+size_t PersistentJson::size() const
+{
+  switch (type())
+  {
+    case Type::kJsonNull:
+      return 0;
+    case Type::kJsonArray:
+      return static_cast<const PersistentArray&>(*node_).size_;
+    case Type::kJsonObject:
+      return static_cast<const PersistentObject&>(*node_).size_;
+    default:
+      return 1;
+  }
+}
+
+bool PersistentJson::empty() const
+{
+  return size() == 0;
+}
+
+bool PersistentJson::same(const PersistentJson& other) const
+{
+  return node_ == other.node_;
+}
+
+void PersistentJson::for_each_element(
+  const std::function<void(size_t, const PersistentJson&)>& f) const
+{
+  EXPECT_ARRAY;
+  const auto& a = static_cast<const PersistentArray&>(*node_);
+  if (a.root_ != nullptr)
+  {
+    size_t i = 0;
+    vector_for_each(a.root_.get(), a.shift_, i, f);
+  }
+}
+
+void PersistentJson::for_each_member(
+  const std::function<void(const string_t&, const PersistentJson&)>& f) const
+{
+  EXPECT_OBJECT;
+  hamt_for_each(static_cast<const PersistentObject&>(*node_).root_.get(), f);
+}
+
+Json PersistentJson::to_json() const
+{
+  switch (type())
+  {
+    case Type::kJsonNull:
+      return Json();
+    case Type::kJsonArray:
+    {
+      Json::array_t arr;
+      arr.reserve(size());
+      for_each_element([&arr](size_t, const PersistentJson& v) {
+        arr.push_back(v.to_json());
+      });
+      return arr;
+    }
+    case Type::kJsonObject:
+    {
+      Json::object_t obj;
+      for_each_member([&obj](const string_t& k, const PersistentJson& v) {
+        obj.emplace(k, v.to_json());
+      });
+      return obj;
+    }
+    default:
+      return static_cast<const PersistentScalar&>(*node_).value_;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Updates.
+
+PersistentJson PersistentJson::set(size_t index,
+                                   const PersistentJson& value) const
+{
+  if (index == size() && (is_null() || is_array()))
+  {
+    return push_back(value);
+  }
+  EXPECT_ARRAY;
+  const auto& a = static_cast<const PersistentArray&>(*node_);
+  REDBUD_THROW_EX_IF(a.size_ <= index, "Json index out of range.");
+  if (vector_leaf(a, index)->values[index & TRIE_MASK].same(value))
+  {
+    return *this;
+  }
+  return PersistentJson(std::make_shared<PersistentArray>(
+    a.size_, a.shift_, vector_set(a.root_.get(), a.shift_, index, value)));
+}
+
+PersistentJson PersistentJson::set(const string_t& key,
+                                   const PersistentJson& value) const
+{
+  if (is_null())
+  {
+    return PersistentJson(Json::object_t{}).set(key, value);
+  }
+  EXPECT_OBJECT;
+  const auto& o = static_cast<const PersistentObject&>(*node_);
+  bool added = false;
+  auto root = hamt_assoc(o.root_, 0,
+                         HamtEntry{ nullptr, key_hash(key), key, value },
+                         added);
+  if (root == o.root_)
+  {
+    return *this;
+  }
+  return PersistentJson(std::make_shared<PersistentObject>(
+    added ? o.size_ + 1 : o.size_, std::move(root)));
+}
+
+PersistentJson PersistentJson::push_back(const PersistentJson& value) const
+{
+  if (is_null())
+  {
+    return PersistentJson(Json::array_t{}).push_back(value);
+  }
+  EXPECT_ARRAY;
+  const auto& a = static_cast<const PersistentArray&>(*node_);
+  uint32_t shift = a.shift_;
+  VectorPtr root = a.root_;
+  size_t capacity = static_cast<size_t>(1) << (shift + TRIE_BITS);
+  if (root != nullptr && a.size_ == capacity)
+  { // The trie is full, grows a new level.
+    auto upper = std::make_shared<VectorNode>();
+    upper->children.push_back(std::move(root));
+    root = std::move(upper);
+    shift += TRIE_BITS;
+  }
+  root = vector_push(root.get(), shift, a.size_, value);
+  return PersistentJson(std::make_shared<PersistentArray>(
+    a.size_ + 1, shift, std::move(root)));
+}
+
+PersistentJson PersistentJson::pop_back() const
+{
+  EXPECT_ARRAY;
+  const auto& a = static_cast<const PersistentArray&>(*node_);
+  REDBUD_THROW_EX_IF(a.size_ == 0, "Json has no value before pop.");
+  uint32_t shift = a.shift_;
+  VectorPtr root = vector_pop(a.root_.get(), shift, a.size_ - 1);
+  while (shift > 0 && root != nullptr && root->children.size() == 1)
+  { // Removes the levels which have only one child.
+    root = root->children[0];
+    shift -= TRIE_BITS;
+  }
+  if (root == nullptr)
+  {
+    shift = 0;
+  }
+  return PersistentJson(std::make_shared<PersistentArray>(
+    a.size_ - 1, shift, std::move(root)));
+}
+
+PersistentJson PersistentJson::erase(const string_t& key) const
+{
+  EXPECT_OBJECT;
+  const auto& o = static_cast<const PersistentObject&>(*node_);
+  bool removed = false;
+  auto root = hamt_dissoc(o.root_, 0, key_hash(key), key, removed);
+  if (!removed)
+  {
+    return *this;
+  }
+  return PersistentJson(std::make_shared<PersistentObject>(
+    o.size_ - 1, std::move(root)));
+}
+
+PersistentJson PersistentJson::set_in(const path_t& path,
+                                      const PersistentJson& value) const
+{
+  return _set_in(path, 0, value);
+}
+
+PersistentJson PersistentJson::_set_in(const path_t& path, size_t i,
+                                       const PersistentJson& value) const
+{
+  if (i == path.size())
+  {
+    return value;
+  }
+  const auto& step = path[i];
+  if (step.is_index())
+  {
+    PersistentJson child = step.index() < size() && is_array()
+      ? (*this)[step.index()] : PersistentJson();
+    return set(step.index(), child._set_in(path, i + 1, value));
+  }
+  PersistentJson child;
+  if (is_object())
+  {
+    auto p = find(step.key());
+    if (p != nullptr)
+    {
+      child = *p;
+    }
+  }
+  return set(step.key(), child._set_in(path, i + 1, value));
+}
+
+// ----------------------------------------------------------------------------
+// Static functions.
+
+std::vector<PersistentJson::Difference>
+PersistentJson::diff(const PersistentJson& from, const PersistentJson& to)
+{
+  std::vector<Difference> out;
+  string_t path;
+  _diff(from, to, path, out);
+  return out;
+}
+
+// Diffs two HAMT nodes at the same shift, skips the shared subnodes, and
+// calls same_key for the values of the keys which exist in both nodes.
+using DiffFunction =
+  std::function<void(const PersistentJson&, const PersistentJson&)>;
+
+static void hamt_diff(const HamtNode* from, const HamtNode* to,
+                      PersistentJson::string_t& path,
+                      std::vector<PersistentJson::Difference>& out,
+                      const DiffFunction& same_key);
+
+void PersistentJson::_diff(const PersistentJson& from, const PersistentJson& to,
+                           string_t& path, std::vector<Difference>& out)
+{
+  if (from.same(to))
+  {
+    return;
+  }
+  if (from.type() != to.type())
+  {
+    out.push_back({ path, DiffKind::kChanged });
+    return;
+  }
+  size_t len = path.size();
+  switch (from.type())
+  {
+    case Type::kJsonNull:
+      break;
+    case Type::kJsonArray:
+    {
+      const auto& a = static_cast<const PersistentArray&>(*from.node_);
+      const auto& b = static_cast<const PersistentArray&>(*to.node_);
+      size_t common = std::min(a.size_, b.size_);
+      if (common != 0)
+      {
+        // The common indices of the taller trie are under its first child.
+        const VectorNode* ra = a.root_.get();
+        const VectorNode* rb = b.root_.get();
+        uint32_t shift = std::min(a.shift_, b.shift_);
+        for (uint32_t level = a.shift_; level > shift; level -= TRIE_BITS)
+        {
+          ra = ra->children.front().get();
+        }
+        for (uint32_t level = b.shift_; level > shift; level -= TRIE_BITS)
+        {
+          rb = rb->children.front().get();
+        }
+        vector_diff(ra, rb, shift, 0, common,
+                    [&path, &out, len](size_t i, const PersistentJson& x,
+                                       const PersistentJson& y) {
+          pointer_append(path, std::to_string(i));
+          _diff(x, y, path, out);
+          path.resize(len);
+        });
+      }
+      for (size_t i = common; i < std::max(a.size_, b.size_); ++i)
+      {
+        pointer_append(path, std::to_string(i));
+        out.push_back({ path, a.size_ < b.size_ ? DiffKind::kAdded
+                                                : DiffKind::kRemoved });
+        path.resize(len);
+      }
+      break;
+    }
+    case Type::kJsonObject:
+    {
+      const auto& a = static_cast<const PersistentObject&>(*from.node_);
+      const auto& b = static_cast<const PersistentObject&>(*to.node_);
+      hamt_diff(a.root_.get(), b.root_.get(), path, out,
+                [&path, &out](const PersistentJson& x,
+                              const PersistentJson& y) {
+        _diff(x, y, path, out);
+      });
+      break;
+    }
+    default:
+      if (scalar_of(from.node_.get()) != scalar_of(to.node_.get()))
+      {
+        out.push_back({ path, DiffKind::kChanged });
+      }
+      break;
+  }
+}
+
+static void hamt_diff(const HamtNode* from, const HamtNode* to,
+                      PersistentJson::string_t& path,
+                      std::vector<PersistentJson::Difference>& out,
+                      const DiffFunction& same_key)
+{
+  using Kind = PersistentJson::DiffKind;
+  using Members = std::map<PersistentJson::string_t, const PersistentJson*>;
+  if (from == to)
+  {
+    return;
+  }
+  size_t len = path.size();
+  auto report = [&path, &out, len](const Members& m, Kind kind) {
+    for (const auto& p : m)
+    {
+      pointer_append(path, p.first);
+      out.push_back({ path, kind });
+      path.resize(len);
+    }
+  };
+  auto compare = [&path, &out, &same_key, &report, len](const Members& a,
+                                                        const Members& b) {
+    Members removed, added;
+    for (const auto& p : a)
+    {
+      auto it = b.find(p.first);
+      if (it == b.end())
+      {
+        removed.insert(p);
+        continue;
+      }
+      pointer_append(path, p.first);
+      same_key(*p.second, *it->second);
+      path.resize(len);
+    }
+    for (const auto& p : b)
+    {
+      if (a.find(p.first) == a.end())
+      {
+        added.insert(p);
+      }
+    }
+    report(removed, Kind::kRemoved);
+    report(added, Kind::kAdded);
+  };
+
+  if (from == nullptr || to == nullptr || from->collision || to->collision)
+  { // Falls back to compare all members.
+    Members a, b;
+    if (from != nullptr)
+    {
+      for (const auto& e : from->entries) hamt_collect(e, a);
+    }
+    if (to != nullptr)
+    {
+      for (const auto& e : to->entries) hamt_collect(e, b);
+    }
+    compare(a, b);
+    return;
+  }
+  uint32_t bits = from->bitmap | to->bitmap;
+  while (bits != 0)
+  {
+    uint32_t bit = bits & (~bits + 1);
+    bits &= bits - 1;
+    const HamtEntry* ea = (from->bitmap & bit)
+      ? &from->entries[hamt_index(from, bit)] : nullptr;
+    const HamtEntry* eb = (to->bitmap & bit)
+      ? &to->entries[hamt_index(to, bit)] : nullptr;
+    if (ea != nullptr && eb != nullptr &&
+        ea->sub != nullptr && eb->sub != nullptr)
+    {
+      hamt_diff(ea->sub.get(), eb->sub.get(), path, out, same_key);
+      continue;
+    }
+    Members a, b;
+    if (ea != nullptr) hamt_collect(*ea, a);
+    if (eb != nullptr) hamt_collect(*eb, b);
+    compare(a, b);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Overloads comparation operator.
+
+bool operator==(const PersistentJson& lhs, const PersistentJson& rhs)
+{
+  if (lhs.same(rhs))
+  {
+    return true;
+  }
+  if (lhs.type() != rhs.type() || lhs.size() != rhs.size())
+  {
+    return false;
+  }
+  switch (lhs.type())
+  {
+    case Json::Type::kJsonArray:
+    {
+      for (size_t i = 0; i < lhs.size(); ++i)
+      {
+        if (lhs[i] != rhs[i])
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+    case Json::Type::kJsonObject:
+    {
+      bool equal = true;
+      lhs.for_each_member([&rhs, &equal](const PersistentJson::string_t& k,
+                                         const PersistentJson& v) {
+        auto p = rhs.find(k);
+        equal = equal && p != nullptr && *p == v;
+      });
+      return equal;
+    }
+    default:
+      return scalar_of(lhs.node_.get()) == scalar_of(rhs.node_.get());
+  }
+}
+
+bool operator!=(const PersistentJson& lhs, const PersistentJson& rhs)
+{
+  return !(lhs == rhs);
+}
+
+#undef TRIE_BITS
+#undef TRIE_WIDTH
+#undef TRIE_MASK
+#undef HASH_BITS
+#undef EXPECT_ARRAY
+#undef EXPECT_OBJECT
+
+} // namespace json
+} // namespace parser
+} // namespace redbud
@@ -0,0 +1,258 @@
+// ============================================================================
+// Copyright (c) 2017 Alinshans. All rights reserved.
+// Licensed under the MIT License. See LICENSE for details.
+//
+// Header File : redbud/parser/persistent_json.h
+//
+// This file contains a PersistentJson class, which is an immutable JSON value
+// sharing its structure between versions.
+// ============================================================================
+
+#ifndef ALINSHANS_REDBUD_PARSER_PERSISTENT_JSON_H_
+#define ALINSHANS_REDBUD_PARSER_PERSISTENT_JSON_H_
+
+#include <functional>        // function
+#include <memory>            // shared_ptr
+#include <string>            // string
+#include <type_traits>
+#include <utility>           // forward
+#include <vector>            // vector
+
+#include "json.h"
+
+namespace redbud
+{
+namespace parser
+{
+namespace json
+{
+
+// ============================================================================
+// Forward declaration
+
+class PersistentNode;
+
+// ============================================================================
+// PersistentJson class
+//
+// This class is a persistent (immutable) version of Json. A PersistentJson
+// never changes after it has been constructed, every update returns a new
+// version which shares all untouched structure with the old one, so keeping
+// many versions of a large document costs memory in proportion to the edits.
+//
+// JSON objects are stored in a hash array mapped trie (HAMT) and JSON arrays
+// are stored in a 32-way persistent vector trie, so updating one path costs
+// O(log n) time and space. Copying a PersistentJson only copies a pointer,
+// and comparing or diffing two versions skips the subtrees they share.
+//
+// Example:
+//   PersistentJson v1 = Json::parse("{\"a\":{\"b\":[1,2,3]},\"c\":true}");
+//   PersistentJson v2 = v1.set_in({ "a", "b", 1 }, 20);
+//   std::cout << v1.to_json();  // {"a":{"b":[1,2,3]},"c":true}
+//   std::cout << v2.to_json();  // {"a":{"b":[1,20,3]},"c":true}
+//   v1["c"].same(v2["c"]);      // true, the unchanged value is shared
+//   PersistentJson::diff(v1, v2);  // { "/a/b/1", kChanged }
+class PersistentJson
+{
+
+  // --------------------------------------------------------------------------
+  // Type definition.
+ public:
+
+  using Type     = Json::Type;
+  using string_t = Json::string_t;
+
+  // One step of a path, an index of a JSON array or a key of a JSON object.
+  class PathStep
+  {
+   public:
+    PathStep(int32_t index) :index_(static_cast<size_t>(index)), key_()
+    {
+      REDBUD_THROW_EX_IF(index < 0, "Expecting a non-negative index.");
+    }
+    PathStep(size_t index) :index_(index), key_() {}
+    PathStep(const char* key) :index_(npos), key_(key) {}
+    PathStep(const string_t& key) :index_(npos), key_(key) {}
+    PathStep(string_t&& key) :index_(npos), key_(std::move(key)) {}
+
+    bool            is_index() const { return index_ != npos; }
+    size_t          index()    const { return index_; }
+    const string_t& key()      const { return key_; }
+
+   private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t   index_;
+    string_t key_;
+  };
+
+  using path_t = std::vector<PathStep>;
+
+  // Kind of a difference between two versions.
+  enum class DiffKind
+  {
+    kAdded   = 0,
+    kRemoved = 1,
+    kChanged = 2
+  };
+
+  // A difference between two versions, the path is a JSON Pointer specified
+  // by RFC 6901, e.g. "/a/b/1".
+  struct Difference
+  {
+    string_t path;
+    DiffKind kind;
+  };
+
+  // --------------------------------------------------------------------------
+  // Constructor / Copy constructor / Move constructor / Destructor
+ public:
+
+  // Default constructor, makes this PersistentJson have a null value.
+  PersistentJson();
+
+  // Converts a Json into a PersistentJson, the scalars of the Json are
+  // shared, the arrays and objects are copied into the tries.
+  PersistentJson(const Json& j);
+
+  // Constructs with any value that can be converted to Json.
+  template <typename T, typename std::enable_if_t<
+    !std::is_same_v<std::decay_t<T>, PersistentJson> &&
+    !std::is_same_v<std::decay_t<T>, Json> &&
+    std::is_constructible_v<Json, T>, int> = 0>
+  PersistentJson(T&& value) :PersistentJson(Json(std::forward<T>(value))) {}
+
+  PersistentJson(const PersistentJson&) = default;
+  PersistentJson(PersistentJson&&) = default;
+
+  ~PersistentJson() = default;
+
+  // --------------------------------------------------------------------------
+  // Copy assignment operator / Move assignment operator
+
+  PersistentJson& operator=(const PersistentJson&) = default;
+  PersistentJson& operator=(PersistentJson&&) = default;
+
+  // --------------------------------------------------------------------------
+  // Element access.
+ public:
+
+  // Returns one of the Json::Type.
+  Type type() const;
+
+  // True if this type is the corresponding Json::Type.
+  bool is_null()   const;
+  bool is_bool()   const;
+  bool is_number() const;
+  bool is_string() const;
+  bool is_array()  const;
+  bool is_object() const;
+
+  // Converts a JSON value to a corresponding value.
+  // If the types do not match, it will yield an exception.
+  bool            as_bool()   const;
+  int32_t         as_int32()  const;
+  uint32_t        as_uint32() const;
+  int64_t         as_int64()  const;
+  uint64_t        as_uint64() const;
+  double          as_double() const;
+  const string_t& as_string() const;
+
+  // Gets the value of a JSON array, if the index is out of range,
+  // an exception will be thrown.
+  const PersistentJson& operator[](size_t index) const;
+
+  // Gets the value of a JSON object, if the key does not exist,
+  // an exception will be thrown.
+  const PersistentJson& operator[](const string_t& key) const;
+
+  // Returns a pointer to the value of the key, or nullptr if the key
+  // does not exist, only for JSON object.
+  const PersistentJson* find(const string_t& key) const;
+
+  // True if the PersistentJson has the key, only for JSON object.
+  bool has_key(const string_t& key) const;
+
+  // Same as Json::size().
+  size_t size() const;
+
+  // True if size() == 0.
+  bool empty() const;
+
+  // True if the two PersistentJson share the same structure, it is cheap
+  // and implies operator==.
+  bool same(const PersistentJson& other) const;
+
+  // Visits all elements of a JSON array or all members of a JSON object.
+  void for_each_element(
+    const std::function<void(size_t, const PersistentJson&)>& f) const;
+  void for_each_member(
+    const std::function<void(const string_t&, const PersistentJson&)>& f) const;
+
+  // Converts this PersistentJson to a mutable Json.
+  Json to_json() const;
+
+  // --------------------------------------------------------------------------
+  // Updates, all of them return a new version and do not modify itself.
+ public:
+
+  // Replaces the value at subscript index of the JSON array, the index
+  // can be equal to size() for appending.
+  PersistentJson set(size_t index, const PersistentJson& value) const;
+
+  // Inserts or replaces the value of the key, only for JSON object.
+  // Like Json::operator[], a null value will be treated as empty object.
+  PersistentJson set(const string_t& key, const PersistentJson& value) const;
+
+  // Appends a value, only for JSON array. A null value will be treated as
+  // an empty array.
+  PersistentJson push_back(const PersistentJson& value) const;
+
+  // Removes the last value, only for JSON array.
+  PersistentJson pop_back() const;
+
+  // Removes the key-value pair, only for JSON object.
+  PersistentJson erase(const string_t& key) const;
+
+  // Replaces the value at the path, the missing keys on the path will be
+  // inserted, e.g.:
+  //   PersistentJson v2 = v1.set_in({ "servers", 0, "port" }, 8080);
+  PersistentJson set_in(const path_t& path, const PersistentJson& value) const;
+
+  // --------------------------------------------------------------------------
+  // Static functions.
+ public:
+
+  // Returns the differences which changes `from` into `to`. The shared
+  // subtrees are skipped, so the cost depends on the size of the edits.
+  static std::vector<Difference> diff(const PersistentJson& from,
+                                      const PersistentJson& to);
+
+  // --------------------------------------------------------------------------
+  // Overloads comparation operator.
+ public:
+
+  friend bool operator==(const PersistentJson& lhs, const PersistentJson& rhs);
+  friend bool operator!=(const PersistentJson& lhs, const PersistentJson& rhs);
+
+  // --------------------------------------------------------------------------
+  // Private member data and member functions.
+ private:
+
+  explicit PersistentJson(std::shared_ptr<const PersistentNode> node);
+
+  PersistentJson _set_in(const path_t& path, size_t i,
+                         const PersistentJson& value) const;
+
+  static void _diff(const PersistentJson& from, const PersistentJson& to,
+                    string_t& path, std::vector<Difference>& out);
+
+  // The root node, nullptr for a null value.
+  std::shared_ptr<const PersistentNode> node_;
+
+};
+
+} // namespace json
+} // namespace parser
+} // namespace redbud
+#endif // !ALINSHANS_REDBUD_PARSER_PERSISTENT_JSON_H_
@@ -12,6 +12,7 @@
 #include <cstring>
 
 #include <fstream>
+#include <utility>
 
 #include "tokenizer.h"
 #include "../exception.h"
@@ -88,6 +89,14 @@ bool Reader::eof() const
   return p_ == context_.size();
 }
 
+std::string Reader::release()
+{
+  std::string s = std::move(context_);
+  context_.clear();
+  p_ = 0;
+  return s;
+}
+
 // ----------------------------------------------------------------------------
 // Setter.
 
@@ -61,6 +61,9 @@ class Reader
   // True if the currently read position has reached the end.
   bool eof() const;
 
+  // Moves the whole string out, the Reader becomes empty.
+  std::string release();
+
   // --------------------------------------------------------------------------
   // Setter.
 